@@ -24,24 +24,26 @@ SOFTWARE.
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "driver/uart.h"
 #include "cli_lite.h"
 
-void caclu_add(void);
-void caclu_sub(void);
-void caclu_mul(void);
-void caclu_div(void);
+int caclu_add(int argc, char **argv);
+int caclu_sub(int argc, char **argv);
+int caclu_mul(int argc, char **argv);
+int caclu_div(int argc, char **argv);
 
-/* 命令列表 新的命令在此注册 */
+/* 命令列表 新的命令在此注册, 顺序不限, cli_init 时按命令名排序 */
 _cmd_table cmd_table[]={
-    {(void *)caclu_add,"add","add [parm1] [parm2]"},
-    {(void *)caclu_sub,"sub","sub [parm1] [parm2]"},
-    {(void *)caclu_mul,"mul","mul [parm1] [parm2]"},
-    {(void *)caclu_div,"div","div [parm1] [parm2]"},
+    {.name="add",.example="add [parm1] [parm2]",.argv_func=caclu_add},
+    {.name="sub",.example="sub [parm1] [parm2]",.argv_func=caclu_sub},
+    {.name="mul",.example="mul [parm1] [parm2]",.argv_func=caclu_mul},
+    {.name="div",.example="div [parm1] [parm2]",.argv_func=caclu_div},
 };
 
 int cmdnum = sizeof(cmd_table)/sizeof(_cmd_table);
 char token[CMD_PARMNUM][CMD_LONGTH]={0};
+static char *cmd_argv[CMD_ARGC_MAX + 1];
 static uint16_t rx_index = 0;
 static uint16_t cursor_pos = 0;
 
@@ -53,6 +55,104 @@ uint8_t rx_buffer[USART_REC_LEN]={0};
 static esc_state_t esc_state = ESC_IDLE;
 bool cmd_deal_ok = 1;
 
+/* 发送环形缓冲, 回显和 cli_printf 先写入这里, 由 cli_flush 合并后写串口 */
+static uint8_t tx_ring[CLI_TX_BUF_SIZE];
+static uint16_t tx_head = 0;                //写入位置
+static uint16_t tx_tail = 0;                //冲刷位置
+static uint32_t tx_dropped = 0;             //非阻塞模式下丢弃的字节数
+static SemaphoreHandle_t tx_lock = NULL;    //保护 tx_head / tx_tail
+static SemaphoreHandle_t flush_lock = NULL; //同一时刻只有一个任务写串口
+static TaskHandle_t tx_flusher = NULL;      //周期调用 cli_flush 的任务, 由 cli_set_flusher 登记
+
+/* 把缓冲内容写入串口驱动, 没有回绕时只调用一次 uart_write_bytes */
+void cli_flush(void){
+    xSemaphoreTake(flush_lock, portMAX_DELAY);
+
+    xSemaphoreTake(tx_lock, portMAX_DELAY);
+    uint16_t head = tx_head;
+    uint16_t tail = tx_tail;
+    xSemaphoreGive(tx_lock);
+
+    if (head != tail){
+        //[tail, head) 只由冲刷方读取, 写入方不会改动这一段
+        if (head > tail){
+            uart_write_bytes(1, &tx_ring[tail], head - tail);
+        }
+        else{
+            uart_write_bytes(1, &tx_ring[tail], CLI_TX_BUF_SIZE - tail);
+            if (head > 0)
+                uart_write_bytes(1, tx_ring, head);
+        }
+
+        xSemaphoreTake(tx_lock, portMAX_DELAY);
+        tx_tail = head;
+        //缓冲已空时回到起点, 下一次冲刷不会回绕
+        if (tx_head == tx_tail){
+            tx_head = 0;
+            tx_tail = 0;
+        }
+        xSemaphoreGive(tx_lock);
+    }
+
+    xSemaphoreGive(flush_lock);
+}
+
+/* 登记周期调用 cli_flush 的任务, 由该任务启动时调用一次 */
+void cli_set_flusher(void){
+    tx_flusher = xTaskGetCurrentTaskHandle();
+}
+
+/* 写入发送缓冲; 缓冲满时阻塞模式先冲刷再继续, 非阻塞模式丢弃剩余部分 */
+static void tx_put(const uint8_t *data, uint16_t len){
+    while (len > 0){
+        xSemaphoreTake(tx_lock, portMAX_DELAY);
+        uint16_t space = (tx_tail + CLI_TX_BUF_SIZE - tx_head - 1) % CLI_TX_BUF_SIZE;
+        uint16_t n = (len < space) ? len : space;
+        uint16_t first = CLI_TX_BUF_SIZE - tx_head;
+
+        if (n <= first){
+            memcpy(&tx_ring[tx_head], data, n);
+        }
+        else{
+            memcpy(&tx_ring[tx_head], data, first);
+            memcpy(tx_ring, data + first, n - first);
+        }
+        tx_head = (tx_head + n) % CLI_TX_BUF_SIZE;
+        data += n;
+        len -= n;
+
+#if CLI_TX_NONBLOCK
+        //只有冲刷任务自己可以等待串口, 其他任务不阻塞;
+        //冲刷任务登记前没有任务会清空缓冲, 初始化输出仍由写入方自己冲刷
+        if (len > 0 && tx_flusher != NULL &&
+            xTaskGetCurrentTaskHandle() != tx_flusher){
+            tx_dropped += len;
+            len = 0;
+        }
+#endif
+        xSemaphoreGive(tx_lock);
+
+        if (len > 0)
+            cli_flush();
+    }
+}
+
+/* 连续写入 n 个相同字符 */
+static void tx_repeat(uint8_t ch, int n){
+    uint8_t buf[16];
+    memset(buf, ch, sizeof(buf));
+    while (n > 0){
+        int k = (n < (int)sizeof(buf)) ? n : (int)sizeof(buf);
+        tx_put(buf, k);
+        n -= k;
+    }
+}
+
+/* 非阻塞模式下因缓冲满丢弃的字节数 */
+uint32_t cli_tx_dropped(void){
+    return tx_dropped;
+}
+
 /* 串口发送打印 */
 void cli_printf(const char *fmt, ...)
 {
@@ -67,16 +167,16 @@ void cli_printf(const char *fmt, ...)
         return;
     }
 
-    if (len > sizeof(buf)) {
-        len = sizeof(buf);
+    if (len > sizeof(buf) - 1) {
+        len = sizeof(buf) - 1;
     }
 
-    uart_write_bytes(1, buf, len);
+    tx_put((uint8_t *)buf, len);
 }
 
 /* 串口发送回显 */
 void uart_echo(uint8_t *data,uint16_t len){
-    uart_write_bytes(1,data,len);
+    tx_put(data,len);
 }
 
 /* 判断前缀 */
@@ -88,6 +188,49 @@ static bool str_start_with(const char *str, const char *prefix){
     return true;
 }
 
+/* 按命令名比较, 供排序使用 */
+static int cmd_compare(const void *a, const void *b){
+    return strcmp(((const _cmd_table *)a)->name,
+                  ((const _cmd_table *)b)->name);
+}
+
+/* 二分查找第一个命令名不小于 key 的位置 */
+static int cmd_lower_bound(const char *key){
+    int lo = 0, hi = cmdnum;
+    while (lo < hi){
+        int mid = (lo + hi) / 2;
+        if (strcmp(cmd_table[mid].name, key) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* 查找命令, 找不到返回 NULL */
+static _cmd_table *cmd_find(const char *name){
+    int i = cmd_lower_bound(name);
+    if (i < cmdnum && !strcmp(cmd_table[i].name, name))
+        return &cmd_table[i];
+    return NULL;
+}
+
+/* 以 prefix 开头的命令在排序后是连续的一段 [*first, 返回值) */
+static int cmd_prefix_range(const char *prefix, int *first){
+    int i = cmd_lower_bound(prefix);
+    *first = i;
+    while (i < cmdnum && str_start_with(cmd_table[i].name, prefix))
+        i++;
+    return i;
+}
+
+/* 初始化命令行, 须在串口收发开始前调用一次 */
+void cli_init(void){
+    qsort(cmd_table, cmdnum, sizeof(_cmd_table), cmd_compare);
+    tx_lock = xSemaphoreCreateMutex();
+    flush_lock = xSemaphoreCreateMutex();
+}
+
 /* 保存历史命令 */
 static void history_save(const char *cmd){
     if (cmd[0] == '\0') return;
@@ -102,11 +245,10 @@ static void history_save(const char *cmd){
 
 /* 清除当前行 */
 static void clear_line(void){
-    while (cursor_pos > 0){
-        uint8_t bs_seq[3] = {'\b', ' ', '\b'};
-        uart_echo(bs_seq, 3);
-        cursor_pos--;
-    }
+    tx_repeat('\b', cursor_pos);
+    tx_repeat(' ', cursor_pos);
+    tx_repeat('\b', cursor_pos);
+    cursor_pos = 0;
 }
 
 /* 方向键←处理 */
@@ -125,6 +267,12 @@ static void cursor_right(void){
     }
 }
 
+/* 光标移到行尾 */
+static void cursor_end(void){
+    uart_echo(&rx_buffer[cursor_pos], rx_index - cursor_pos);
+    cursor_pos = rx_index;
+}
+
 /* 方向键↑处理 */
 static void cmd_history_up(void){
     if (history_count == 0) return;
@@ -136,10 +284,7 @@ static void cmd_history_up(void){
 
     history_index--;
 
-    while (cursor_pos < rx_index){
-        cursor_right();
-    }
-        
+    cursor_end();
     clear_line();
 
     strcpy((char *)rx_buffer,
@@ -161,9 +306,7 @@ static void cmd_history_down(void){
 
     if (history_index == history_count)
     {
-        while (cursor_pos < rx_index)
-            cursor_right();
-
+        cursor_end();
         clear_line();
         rx_index = 0;
         cursor_pos = 0;
@@ -171,10 +314,7 @@ static void cmd_history_down(void){
         return;
     }
 
-    while (cursor_pos < rx_index){
-        cursor_right();
-    }
-
+    cursor_end();
     clear_line();
     strcpy((char *)rx_buffer,
            cmd_history[history_index % CMD_HISTORY_NUM]);
@@ -237,45 +377,31 @@ void cli_deal(uint8_t rx_data){
                     rx_index - cursor_pos);
             uart_echo((uint8_t *)" ", 1);
 
-            for (int i = 0; i <= rx_index - cursor_pos; i++)
-                uart_echo((uint8_t *)"\b", 1);
+            tx_repeat('\b', rx_index - cursor_pos + 1);
         }
         goto rx_exit;
     }
 
     if (rx_data == CMD_HT){
-        uint8_t match = 0;
-        const char *last = NULL;
+        int first, last;
 
         rx_buffer[rx_index] = '\0';
+        last = cmd_prefix_range((char *)rx_buffer, &first);
 
-        for (int i = 0; i < cmdnum; i++){
-            if (str_start_with(cmd_table[i].name,
-                            (char *)rx_buffer)){
-                match++;
-                last = cmd_table[i].name;
-            }
-        }
-
-        if (match == 1 && last){
-            const char *p = last + rx_index;
+        if (last - first == 1){
+            const char *p = cmd_table[first].name + rx_index;
             while (*p && rx_index < USART_REC_LEN - 1){
-                rx_buffer[rx_index++] = *p;
-                uart_echo((uint8_t *)p, 1);
-                p++;
+                rx_buffer[rx_index++] = *p++;
             }
-            cursor_pos = rx_index;
+            cursor_end();
         }
-        else if (match > 1){
+        else if (last - first > 1){
             const char nl[] = "\r\n";
             uart_echo((uint8_t *)nl, 2);
-            for (int i = 0; i < cmdnum; i++){
-                if (str_start_with(cmd_table[i].name,
-                                (char *)rx_buffer)){
-                    uart_echo((uint8_t *)cmd_table[i].name,
-                            strlen(cmd_table[i].name));
-                    uart_echo((uint8_t *)nl, 2);
-                }
+            for (int i = first; i < last; i++){
+                uart_echo((uint8_t *)cmd_table[i].name,
+                        strlen(cmd_table[i].name));
+                uart_echo((uint8_t *)nl, 2);
             }
             const char prompt[] = "[LEON]@LINKS:";
             uart_echo((uint8_t *)prompt, strlen(prompt));
@@ -296,8 +422,7 @@ void cli_deal(uint8_t rx_data){
             uart_echo(&rx_buffer[cursor_pos - 1],
                     rx_index - cursor_pos + 1);
 
-            for (int i = 0; i < rx_index - cursor_pos; i++)
-                uart_echo((uint8_t *)"\b", 1);
+            tx_repeat('\b', rx_index - cursor_pos);
         }
     }
 
@@ -305,136 +430,241 @@ rx_exit:
     process_cmd();
 }
 
-/* 执行命令 */
-void execute_cmd(void){
-    int cmd_is_find = 0;
-    if(strlen(token[0])!=0){
-        if(!strcmp(token[0],"cmd")){
-			cli_printf("-------------------- Cmd Table --------------------\r\n");
-            for(int i=0;i<cmdnum;i++){
-                cli_printf("cmd:%s    eg:%s\r\n",cmd_table[i].name,cmd_table[i].example);
-            }
-            cli_printf("---------------------------------------------------\r\n");
+/* 原地切分命令行: 空格改写为 '\0', argv 直接指向 line 中的各个参数 */
+static int cmd_split(char *line, char **argv){
+    int argc = 0;
+
+    while (*line){
+        while (*line == ' ')
+            line++;
+        if (*line == '\0')
+            break;
+
+        argv[argc++] = line;
+        while (*line && *line != ' ')
+            line++;
+        if (*line)
+            *line++ = '\0';
+    }
+    argv[argc] = NULL;
+    return argc;
+}
+
+/* 旧接口命令: 把参数复制到 token, 超长参数和多余参数被截断 */
+static void cmd_fill_token(int argc, char **argv){
+    for(int i=0;i<CMD_PARMNUM;i++){
+        if(i<argc){
+            strncpy(token[i],argv[i],CMD_LONGTH-1);
+            token[i][CMD_LONGTH-1] = '\0';
         }
         else{
-            for(int j=0;j<cmdnum;j++){
-                if(!strcmp(token[0],cmd_table[j].name)){
-                    cmd_table[j].func();
-                    cmd_is_find++;
-                }
-            }
-            if(cmd_is_find==0){
-                cli_printf("Cmd Error!\r\n");
-            }
+            token[i][0] = '\0';
         }
     }
+}
+
+/* 执行命令 */
+void execute_cmd(int argc, char **argv){
+    if(argc==0){
+        return;
+    }
+
+    if(!strcmp(argv[0],"cmd")){
+		cli_printf("-------------------- Cmd Table --------------------\r\n");
+        for(int i=0;i<cmdnum;i++){
+            cli_printf("cmd:%s    eg:%s\r\n",cmd_table[i].name,cmd_table[i].example);
+        }
+        cli_printf("---------------------------------------------------\r\n");
+        return;
+    }
 
-	memset(token,0,CMD_PARMNUM*CMD_LONGTH);
+    _cmd_table *cmd = cmd_find(argv[0]);
+    if(cmd==NULL){
+        cli_printf("Cmd Error!\r\n");
+    }
+    else if(cmd->argv_func!=NULL){
+        if(cmd->argv_func(argc,argv)<0){
+            cli_printf("cmd parm invalid!  eg:%s\r\n",cmd->example);
+        }
+    }
+    else if(cmd->func!=NULL){
+        cmd_fill_token(argc,argv);
+        cmd->func();
+    }
 }
 
 /* 命令处理函数 */
 void process_cmd(void){
-    char tmp_data='\0';
-    int buf_count=0;
-    int parm_count=0;
-    int str_count=0;
-
     if(cmd_deal_ok==0){
-		int rx_len = strlen((const char*)rx_buffer);
-        for(int i=0;i<rx_len;i++){
-            tmp_data = rx_buffer[buf_count];
-            if((tmp_data!='\r')||(tmp_data!='\n')||(tmp_data!='\0')){
-                if(tmp_data!=' '){
-                    token[parm_count][str_count] = tmp_data;
-                    if(str_count<CMD_LONGTH-1){
-                        str_count++;
-                    }
-                }
-                else{
-                    token[parm_count][str_count] = '\0';
-                    if(parm_count<CMD_PARMNUM-1){
-                        parm_count++;
-                    }
-                    str_count = 0;
-                }
-            }
-            if(buf_count<USART_REC_LEN-1){
-                buf_count++;
-            }
-        }
+        int argc = cmd_split((char *)rx_buffer,cmd_argv);
 		cli_printf("\r\n");
-        execute_cmd();
-        memset(rx_buffer,0,USART_REC_LEN);
+        execute_cmd(argc,cmd_argv);
+        rx_buffer[0] = '\0';
         cmd_deal_ok = 1;
         cli_printf("[LEON]@LINKS:");
     }
 }
 
-/* 命令示例 */
-void caclu_add(void){
-    int parm1=0,parm2=0;
-
-    if(strlen(token[1])==0){
-        cli_printf("cmd parm invalid!\r\n");
-        return;
+/* 解析十进制整数, 可带正负号, 越界或含非法字符时返回 false */
+bool cli_parse_int(const char *str, int32_t min, int32_t max, int32_t *val){
+    bool neg = false;
+    uint32_t acc = 0;
+
+    if (str == NULL) return false;
+    if (*str == '+' || *str == '-')
+        neg = (*str++ == '-');
+    if (*str == '\0') return false;
+
+    while (*str){
+        uint32_t d = (uint32_t)(*str++ - '0');
+        if (d > 9) return false;
+        if (acc > (UINT32_MAX - d) / 10) return false;
+        acc = acc * 10 + d;
     }
-    if(strlen(token[2])==0){
-        cli_printf("cmd parm invalid!\r\n");
-        return;
+
+    int64_t v = neg ? -(int64_t)acc : (int64_t)acc;
+    if (v < min || v > max) return false;
+    *val = (int32_t)v;
+    return true;
+}
+
+/* 解析十六进制整数, 可带 0x 前缀, 最多 8 位 */
+bool cli_parse_hex(const char *str, uint32_t min, uint32_t max, uint32_t *val){
+    uint32_t acc = 0;
+    int n = 0;
+
+    if (str == NULL) return false;
+    if (str[0] == '0' && (str[1] == 'x' || str[1] == 'X'))
+        str += 2;
+
+    for (; *str; str++, n++){
+        char c = *str;
+        uint32_t d;
+        if (c >= '0' && c <= '9')      d = c - '0';
+        else if (c >= 'a' && c <= 'f') d = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') d = c - 'A' + 10;
+        else return false;
+        if (n >= 8) return false;
+        acc = (acc << 4) | d;
     }
+    if (n == 0) return false;
 
-    parm1 = atoi(token[1]);
-    parm2 = atoi(token[2]);
-    cli_printf("add result %d \r\n",parm1+parm2);
+    if (acc < min || acc > max) return false;
+    *val = acc;
+    return true;
 }
 
-void caclu_sub(void){
-    int parm1=0,parm2=0;
+/* 10 的 0~10 次幂, 单精度下都是精确值 */
+static const float pow10_tab[11] = {
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
 
-    if(strlen(token[1])==0){
-        cli_printf("cmd parm invalid!\r\n");
-        return;
+/* 解析小数, 支持 1.5 / -.25 / 3e-2 这类写法, 只用单精度运算 */
+bool cli_parse_float(const char *str, float min, float max, float *val){
+    bool neg = false;
+    uint32_t mant = 0;
+    int digits = 0;         //已计入 mant 的有效数字个数
+    int seen = 0;           //出现过的数字个数
+    int exp10 = 0;
+
+    if (str == NULL) return false;
+    if (*str == '+' || *str == '-')
+        neg = (*str++ == '-');
+
+    for (; *str >= '0' && *str <= '9'; str++, seen++){
+        if (digits < 9){
+            mant = mant * 10 + (*str - '0');
+            if (mant) digits++;
+        }
+        else{
+            exp10++;
+        }
     }
-    if(strlen(token[2])==0){
-        cli_printf("cmd parm invalid!\r\n");
-        return;
+    if (*str == '.'){
+        for (str++; *str >= '0' && *str <= '9'; str++, seen++){
+            if (digits < 9){
+                mant = mant * 10 + (*str - '0');
+                if (mant) digits++;
+                exp10--;
+            }
+        }
+    }
+    if (seen == 0) return false;
+
+    if (*str == 'e' || *str == 'E'){
+        int32_t e;
+        if (!cli_parse_int(str + 1, -99, 99, &e)) return false;
+        exp10 += e;
+    }
+    else if (*str != '\0'){
+        return false;
     }
 
-    parm1 = atoi(token[1]);
-    parm2 = atoi(token[2]);
-    cli_printf("sub result %d \r\n",parm1-parm2);
+    float f = (float)mant;
+    if (mant != 0){
+        if (exp10 + digits > 39 || exp10 + digits < -37) return false;
+        for (; exp10 > 10; exp10 -= 10) f *= 1e10f;
+        for (; exp10 < -10; exp10 += 10) f /= 1e10f;
+        if (exp10 >= 0) f *= pow10_tab[exp10];
+        else            f /= pow10_tab[-exp10];
+    }
+    if (neg) f = -f;
+
+    if (f < min || f > max) return false;
+    *val = f;
+    return true;
 }
 
-void caclu_mul(void){
-    int parm1=0,parm2=0;
+/* 命令示例 */
+int caclu_add(int argc, char **argv){
+    int32_t parm1,parm2;
 
-    if(strlen(token[1])==0){
-        cli_printf("cmd parm invalid!\r\n");
-        return;
+    if(argc!=3 ||
+       !cli_parse_int(argv[1],INT32_MIN,INT32_MAX,&parm1) ||
+       !cli_parse_int(argv[2],INT32_MIN,INT32_MAX,&parm2)){
+        return -1;
     }
-    if(strlen(token[2])==0){
-        cli_printf("cmd parm invalid!\r\n");
-        return;
+
+    cli_printf("add result %lld \r\n",(long long)parm1+parm2);
+    return 0;
+}
+
+int caclu_sub(int argc, char **argv){
+    int32_t parm1,parm2;
+
+    if(argc!=3 ||
+       !cli_parse_int(argv[1],INT32_MIN,INT32_MAX,&parm1) ||
+       !cli_parse_int(argv[2],INT32_MIN,INT32_MAX,&parm2)){
+        return -1;
     }
 
-    parm1 = atoi(token[1]);
-    parm2 = atoi(token[2]);
-    cli_printf("mul result %d \r\n",parm1*parm2);
+    cli_printf("sub result %lld \r\n",(long long)parm1-parm2);
+    return 0;
 }
 
-void caclu_div(void){
-    int parm1=0,parm2=0;
+int caclu_mul(int argc, char **argv){
+    int32_t parm1,parm2;
 
-    if(strlen(token[1])==0){
-        cli_printf("cmd parm invalid!\r\n");
-        return;
+    if(argc!=3 ||
+       !cli_parse_int(argv[1],INT32_MIN,INT32_MAX,&parm1) ||
+       !cli_parse_int(argv[2],INT32_MIN,INT32_MAX,&parm2)){
+        return -1;
     }
-    if(strlen(token[2])==0){
-        cli_printf("cmd parm invalid!\r\n");
-        return;
+
+    cli_printf("mul result %lld \r\n",(long long)parm1*parm2);
+    return 0;
+}
+
+int caclu_div(int argc, char **argv){
+    int32_t parm1,parm2;
+
+    if(argc!=3 ||
+       !cli_parse_int(argv[1],INT32_MIN,INT32_MAX,&parm1) ||
+       !cli_parse_int(argv[2],INT32_MIN,INT32_MAX,&parm2) ||
+       parm2==0){
+        return -1;
     }
 
-    parm1 = atoi(token[1]);
-    parm2 = atoi(token[2]);
-    cli_printf("div result %d \r\n",parm1/parm2);
+    cli_printf("div result %lld \r\n",(long long)parm1/parm2);
+    return 0;
 }
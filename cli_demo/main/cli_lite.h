@@ -35,8 +35,11 @@ SOFTWARE.
 #define USART_REC_LEN               128     //定义串口一次接收的最大字节数
 #define CMD_HISTORY_NUM             10      //定义历史命令记录条数
 #define CMD_MAX_LEN                 128     //命令一条命令最大的长度
-#define CMD_PARMNUM                 8       //每条命令支持的最多参数个数
-#define CMD_LONGTH                  16      //每条命令的每个参数的最大长度
+#define CLI_TX_BUF_SIZE             512     //发送环形缓冲大小
+#define CLI_TX_NONBLOCK             0       //1: 缓冲满时丢弃并计数, 不阻塞调用者
+#define CMD_ARGC_MAX                (USART_REC_LEN/2)   //argv 接口一条命令最多的参数个数(含命令名)
+#define CMD_PARMNUM                 8       //旧接口 token 支持的最多参数个数
+#define CMD_LONGTH                  16      //旧接口 token 每个参数的最大长度
 
 #define CMD_NU		                0x00    //空字符
 #define CMD_ETX		                0x03    //正文结束
@@ -45,11 +48,16 @@ SOFTWARE.
 #define CMD_LF		                0x0a    //换行键
 #define CMD_CR		                0x0d    //回车键(Enter键)
 
-/* 命令结构体 */
+/*
+ * 命令结构体
+ * argv_func 非空时以 argc/argv 调用, argv 直接指向接收缓冲, 只在回调期间有效,
+ * 返回负数表示参数错误并打印命令说明; 否则调用旧接口 func, 参数在 token 中
+ */
 typedef struct _cmd_table{
-    void(*func)(void);          //命令执行回调
+    void(*func)(void);          //命令执行回调(旧接口)
     const char* name;           //命令名
     const char* example;        //命令说明
+    int(*argv_func)(int argc, char **argv);  //命令执行回调(argc/argv 接口)
 }_cmd_table;
 
 /* 状态枚举 */
@@ -61,8 +69,16 @@ typedef enum {
 
 extern char token[CMD_PARMNUM][CMD_LONGTH];
 
+void cli_init(void);
 void cli_printf(const char *fmt, ...);
+void cli_flush(void);
+void cli_set_flusher(void);
+uint32_t cli_tx_dropped(void);
 void cli_deal(uint8_t rx_data);
 void process_cmd(void);
 
+bool cli_parse_int(const char *str, int32_t min, int32_t max, int32_t *val);
+bool cli_parse_hex(const char *str, uint32_t min, uint32_t max, uint32_t *val);
+bool cli_parse_float(const char *str, float min, float max, float *val);
+
 #endif
@@ -62,11 +62,14 @@ void cli_task(void *pvParameters);
 TaskHandle_t CLI_TASK_Handler;
 #define CLI_TASK_STK_SIZE  4096
 #define CLI_TASK_PRIO  1
+#define CLI_FLUSH_MS  20     //无输入时发送缓冲的冲刷周期
 
 portMUX_TYPE main_mux = portMUX_INITIALIZER_UNLOCKED;
 
 /* 启动任务 */
 void app_main(void){
+    cli_init();
+
     taskENTER_CRITICAL(&main_mux);
 
     xTaskCreatePinnedToCore((TaskFunction_t )uart_task,
@@ -162,12 +165,15 @@ void uart_task(void *pvParameters){
 /* 命令行处理任务 */
 void cli_task(void *pvParameters){
     uint8_t buf[128] = {0};
+    cli_set_flusher();
     for(;;){
-        size_t len = xStreamBufferReceive(Uart_Data_Stream,buf,sizeof(buf),portMAX_DELAY);
+        size_t len = xStreamBufferReceive(Uart_Data_Stream,buf,sizeof(buf),pdMS_TO_TICKS(CLI_FLUSH_MS));
         for (int i = 0; i < len; i++){
             uint8_t ch = buf[i];
             cli_deal(ch);
         }
+        //本批字符的回显和命令输出一次写出, 也带出其他任务的 cli_printf
+        cli_flush();
         vTaskDelay(pdMS_TO_TICKS(10));
     }
 }
@@ -0,0 +1,187 @@
+/*******************************************************************************
+MIT License
+
+Copyright (c) 2021 LEON-LINKS-room
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#ifndef __CNN_CONST_H__
+#define __CNN_CONST_H__
+
+#include "cnn_demo.h"
+
+/*
+ * Ȩؾ: Ȩڱʱ˲ F ,  m_axi 
+ * F ṩ C_IN / C_OUT / KS, Ȩλ W_W  w(co, ky, kx, c).
+ * ÿȨչΪʽ (NAF)  -1/0/+1 λ, ͬһͨгͷ
+ * λ, ÿλһκۼ:
+ *     sum = sum_b 2^b * (sum_{d=+1} a - sum_{d=-1} a)
+ * Ȩǳ, λۺʱȷ, ֻʣӼ͹̶λ: 0 Ȩ
+ * κ߼, +-2^k ֻһλ, ͬλĳͷͬһλ.
+ * ʹó˷.
+ */
+
+//w  NAF  b λ (-1/0/+1), λһ. W_W λз W_W λ
+inline int naf_digit(int w, int b) {
+#pragma HLS INLINE
+    int d = 0;
+    for (int i = 0; i <= b; i++) {
+#pragma HLS UNROLL
+        d = (w & 1) ? 2 - (w & 3) : 0;
+        w = (w - d) >> 1;
+    }
+    return d;
+}
+
+/*
+ * ǰ˱Ե / ˲, 3x3, ͨȨͬ:
+ * Sobel x, Sobel y, Laplacian, 3x3 ˹ƽ. Ȩض 0  +-2^k.
+ */
+template<int C>
+struct edge_bank {
+    static const int C_IN = C;
+    static const int C_OUT = 4;
+    static const int KS = 3;
+    static const int W_W = 4;
+
+    static int w(int co, int ky, int kx, int c) {
+#pragma HLS INLINE
+        static const signed char k[4][3][3] = {
+            {{-1, 0, 1}, {-2, 0, 2}, {-1, 0, 1}},
+            {{-1, -2, -1}, {0, 0, 0}, {1, 2, 1}},
+            {{0, 1, 0}, {1, -4, 1}, {0, 1, 0}},
+            {{1, 2, 1}, {2, 4, 2}, {1, 2, 1}}
+        };
+        return k[co][ky][kx];
+    }
+};
+
+//㳣Ȩģʽ (CONV_CONST_WEIGHTS) ʹõ˲
+typedef edge_bank<IN_C> conv_bank;
+
+/*
+ * Ȩصĳۼ,  conv_mac_engine ʹ (ӿͬ buf_mac)
+ * Ȩػ, weight ֻһõԪ. λΪ A_W+clog2(N+1) λ;
+ * ǰĲֺͿܳսһ, ۼӱ SUM_W  1 λ.
+ */
+template<class F>
+struct naf_mac {
+    static const int W_W = F::W_W;
+    static const int WEIGHTS = 1;
+    typedef ap_int<1> weight_t;
+
+    template<int SUM_W, int A_W, int E, int DIL>
+    static ap_int<SUM_W> mac(
+        ap_int<A_W> window[E][E][F::C_IN],
+        weight_t weight[WEIGHTS],
+        int co
+    ) {
+#pragma HLS INLINE
+        const int KS = F::KS;
+        const int C_IN = F::C_IN;
+        const int PLANE_W = A_W + clog2<KS * KS * C_IN + 1>::value;
+        ap_int<SUM_W + 1> sum = 0;
+
+        // NAF λ: ͬһλĳͷȼӼ, λһ
+        for (int b = 0; b < F::W_W; b++) {
+#pragma HLS UNROLL
+            ap_int<PLANE_W> plane = 0;
+
+            for (int ky = 0; ky < KS; ky++) {
+                for (int kx = 0; kx < KS; kx++) {
+                    for (int c = 0; c < C_IN; c++) {
+#pragma HLS UNROLL
+                        int d = naf_digit(F::w(co, ky, kx, c), b);
+                        if (d > 0)
+                            plane += window[ky * DIL][kx * DIL][c];
+                        else if (d < 0)
+                            plane -= window[ky * DIL][kx * DIL][c];
+                    }
+                }
+            }
+            sum += (ap_int<SUM_W + 1>)plane << b;
+        }
+        return sum;
+    }
+};
+
+/*
+ * Ȩؾ, ֻ֧ valid,  1
+ * л塢ʱߴͬ conv_engine, ۼӻ naf_mac.
+ * w_none ڱ, Ϊ DATAFLOW ûд뷽ͨ.
+ */
+template<int H, int W, class F, int A_W, int O_W, int B_W>
+void const_conv_engine(
+    hls::stream<pixel_pkt<F::C_IN, A_W> > &in_stream,
+    hls::stream<pixel_pkt<F::C_OUT, O_W> > &out_stream,
+    ap_int<B_W> bias[F::C_OUT],
+    qmul_t qmul[F::C_OUT],
+    qshift_t qshift[F::C_OUT],
+    act_t act,
+    ap_uint<8> act_param,
+    dim_t rows,
+    dim_t cols,
+    dim_t chans
+) {
+    ap_int<1> w_none[1];
+    conv_mac_engine<H, W, F::C_IN, F::C_OUT, F::KS, 1, naf_mac<F> >(
+        in_stream, out_stream, w_none, bias, qmul, qshift, act, act_param,
+        rows, cols, chans, 1);
+}
+
+/*
+ * AXI-Stream ӿڵĳȨؾ, ˿ conv_axis ͬԱ㶥л,
+ * weight ȡ.  (rows-KS+1) x (cols-KS+1), rows / cols ͬ conv_axis
+ * .
+ */
+template<int H, int W, class F, int BUS_W>
+void const_conv_axis(
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > &in_stream,
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > &out_stream,
+    const wbus_t *weight,
+    bias_t bias[F::C_OUT],
+    qmul_t qmul[F::C_OUT],
+    qshift_t qshift[F::C_OUT],
+    act_t act,
+    ap_uint<8> act_param,
+    ap_uint<32> frames,
+    dim_t rows,
+    dim_t cols,
+    dim_t chans
+) {
+#pragma HLS DATAFLOW
+    const int OH = H - F::KS + 1;
+    const int OW = W - F::KS + 1;
+    dim_t nrows = dim_clamp(rows, F::KS, H);
+    dim_t ncols = dim_clamp(cols, F::KS, W);
+    ap_uint<32> out_pix_n = (nrows - F::KS + 1) * (ncols - F::KS + 1);
+
+    hls::stream<pixel_pkt<F::C_IN> > in_pix;
+    hls::stream<pixel_pkt<F::C_OUT> > out_pix;
+#pragma HLS STREAM variable=in_pix depth=2
+#pragma HLS STREAM variable=out_pix depth=2
+
+    axis_unpack<H * W, F::C_IN, BUS_W>(in_stream, in_pix, frames, nrows * ncols);
+    const_conv_engine<H, W, F>(in_pix, out_pix, bias, qmul, qshift,
+                               act, act_param, nrows, ncols, chans);
+    axis_pack<OH * OW, F::C_OUT, BUS_W>(out_pix, out_stream, out_pix_n);
+}
+
+#endif
@@ -22,90 +22,262 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 *******************************************************************************/
 
-#include <ap_int.h>
-#include <hls_stream.h>
-#include <ap_axi_sdata.h>
+#include "cnn_demo.h"
+#include "cnn_winograd.h"
+#include "cnn_dwsep.h"
+#include "cnn_const.h"
+#include "cnn_gemm.h"
 
-#define IN_H   14
-#define IN_W   14
-#define IN_C   3
-
-#define K      3
+void cnn_conv_layer(
+    hls::stream<axis_t> &in_stream,
+    hls::stream<axis_t> &out_stream,
+    const wbus_t *weight,
+    bias_t bias[OUT_C],
+    qmul_t qmul[OUT_C],
+    qshift_t qshift[OUT_C],
+    act_t act,
+    ap_uint<8> act_param,
+    ap_uint<32> frames,
+    dim_t rows,
+    dim_t cols,
+    dim_t chans,
+    stride_t stride,
+    dim_t pad
+#if CONV_PERF
+    , axis_perf &perf_in,
+    axis_perf &perf_out
+#endif
+) {
+#pragma HLS INTERFACE axis port=in_stream
+#pragma HLS INTERFACE axis port=out_stream
+#pragma HLS INTERFACE m_axi port=weight offset=slave bundle=gmem depth=CONV_W_DEPTH
+#pragma HLS INTERFACE s_axilite port=bias
+#pragma HLS INTERFACE s_axilite port=qmul
+#pragma HLS INTERFACE s_axilite port=qshift
+#pragma HLS INTERFACE s_axilite port=act
+#pragma HLS INTERFACE s_axilite port=act_param
+#pragma HLS INTERFACE s_axilite port=frames
+#pragma HLS INTERFACE s_axilite port=rows
+#pragma HLS INTERFACE s_axilite port=cols
+#pragma HLS INTERFACE s_axilite port=chans
+#pragma HLS INTERFACE s_axilite port=stride
+#pragma HLS INTERFACE s_axilite port=pad
+#if CONV_PERF
+#pragma HLS INTERFACE s_axilite port=perf_in
+#pragma HLS INTERFACE s_axilite port=perf_out
+#endif
+#pragma HLS INTERFACE ap_ctrl_chain port=return
+#pragma HLS INTERFACE s_axilite port=return
 
-#define OUT_H  (IN_H - K + 1)
-#define OUT_W  (IN_W - K + 1)
+#if CONV_CONST_WEIGHTS
+    //Ȩع̶, ֻ֧ valid,  1, weight / stride / pad 
+    typedef char bank_check[(conv_bank::C_OUT == OUT_C &&
+                             conv_bank::KS == K) ? 1 : -1];
+    const_conv_axis<IN_H, IN_W, conv_bank, AXIS_W>(in_stream, out_stream,
+                                                   weight, bias, qmul, qshift,
+                                                   act, act_param, frames,
+                                                   rows, cols, chans);
+#elif CONV_WINOGRAD
+    //Winograd ֻ֧ valid,  1, stride  pad 
+    winograd_axis<IN_H, IN_W, IN_C, OUT_C, AXIS_W>(in_stream, out_stream,
+                                               weight, bias, qmul, qshift,
+                                               act, act_param, frames,
+                                               rows, cols, chans);
+#elif CONV_PERF
+    conv_ext_perf_axis<IN_H, IN_W, IN_C, OUT_C, K, CONV_DIL, CONV_PAD_MAX,
+                       AXIS_W, true>(
+        in_stream, out_stream, weight, bias, qmul, qshift, act, act_param,
+        frames, rows, cols, chans, stride, pad, perf_in, perf_out);
+#else
+    conv_ext_axis<IN_H, IN_W, IN_C, OUT_C, K, CONV_DIL, CONV_PAD_MAX, AXIS_W>(
+        in_stream, out_stream, weight, bias, qmul, qshift, act, act_param,
+        frames, rows, cols, chans, stride, pad);
+#endif
 
-//Ͷ
-typedef ap_int<8>  data_t;
-typedef ap_int<32> acc_t;
-typedef ap_axis<8, 0, 0, 0> axis_t;
+#if CONV_PERF && (CONV_CONST_WEIGHTS || CONV_WINOGRAD)
+    //ֱֻӷ
+    axis_perf zero;
+    zero.beats = 0;
+    zero.stall = 0;
+    zero.cycles = 0;
+    zero.frame_cycles = 0;
+    perf_in = zero;
+    perf_out = zero;
+#endif
+}
 
-void cnn_conv_layer(
+void cnn_conv_pool_layer(
     hls::stream<axis_t> &in_stream,
     hls::stream<axis_t> &out_stream,
-    data_t weight[K][K][IN_C],
-    data_t bias
+    const wbus_t *weight,
+    bias_t bias[OUT_C],
+    qmul_t qmul[OUT_C],
+    qshift_t qshift[OUT_C],
+    act_t act,
+    ap_uint<8> act_param,
+    pool_t pool_mode,
+    ap_uint<32> frames,
+    dim_t rows,
+    dim_t cols,
+    dim_t chans
 ) {
 #pragma HLS INTERFACE axis port=in_stream
 #pragma HLS INTERFACE axis port=out_stream
-#pragma HLS INTERFACE s_axilite port=weight
+#pragma HLS INTERFACE m_axi port=weight offset=slave bundle=gmem depth=CONV_W_DEPTH
 #pragma HLS INTERFACE s_axilite port=bias
+#pragma HLS INTERFACE s_axilite port=qmul
+#pragma HLS INTERFACE s_axilite port=qshift
+#pragma HLS INTERFACE s_axilite port=act
+#pragma HLS INTERFACE s_axilite port=act_param
+#pragma HLS INTERFACE s_axilite port=pool_mode
+#pragma HLS INTERFACE s_axilite port=frames
+#pragma HLS INTERFACE s_axilite port=rows
+#pragma HLS INTERFACE s_axilite port=cols
+#pragma HLS INTERFACE s_axilite port=chans
+#pragma HLS INTERFACE ap_ctrl_chain port=return
+#pragma HLS INTERFACE s_axilite port=return
+
+    conv_pool_axis<IN_H, IN_W, IN_C, OUT_C, K, POOL_K, POOL_S, AXIS_W>(
+        in_stream, out_stream, weight, bias, qmul, qshift,
+        act, act_param, pool_mode, frames, rows, cols, chans);
+}
+
+void cnn_dwsep_layer(
+    hls::stream<axis_t> &in_stream,
+    hls::stream<axis_t> &out_stream,
+    const wbus_t *dw_weight,
+    bias_t dw_bias[IN_C],
+    qmul_t dw_qmul[IN_C],
+    qshift_t dw_qshift[IN_C],
+    act_t dw_act,
+    ap_uint<8> dw_param,
+    const wbus_t *pw_weight,
+    bias_t pw_bias[OUT_C],
+    qmul_t pw_qmul[OUT_C],
+    qshift_t pw_qshift[OUT_C],
+    act_t pw_act,
+    ap_uint<8> pw_param,
+    ap_uint<32> frames,
+    dim_t rows,
+    dim_t cols,
+    dim_t chans
+) {
+#pragma HLS INTERFACE axis port=in_stream
+#pragma HLS INTERFACE axis port=out_stream
+#pragma HLS INTERFACE m_axi port=dw_weight offset=slave bundle=gmem0 depth=DW_W_DEPTH
+#pragma HLS INTERFACE s_axilite port=dw_bias
+#pragma HLS INTERFACE s_axilite port=dw_qmul
+#pragma HLS INTERFACE s_axilite port=dw_qshift
+#pragma HLS INTERFACE s_axilite port=dw_act
+#pragma HLS INTERFACE s_axilite port=dw_param
+#pragma HLS INTERFACE m_axi port=pw_weight offset=slave bundle=gmem1 depth=PW_W_DEPTH
+#pragma HLS INTERFACE s_axilite port=pw_bias
+#pragma HLS INTERFACE s_axilite port=pw_qmul
+#pragma HLS INTERFACE s_axilite port=pw_qshift
+#pragma HLS INTERFACE s_axilite port=pw_act
+#pragma HLS INTERFACE s_axilite port=pw_param
+#pragma HLS INTERFACE s_axilite port=frames
+#pragma HLS INTERFACE s_axilite port=rows
+#pragma HLS INTERFACE s_axilite port=cols
+#pragma HLS INTERFACE s_axilite port=chans
+#pragma HLS INTERFACE ap_ctrl_chain port=return
+#pragma HLS INTERFACE s_axilite port=return
+
+    dwsep_axis<IN_H, IN_W, IN_C, OUT_C, K, PW_PAR, AXIS_W>(
+        in_stream, out_stream,
+        dw_weight, dw_bias, dw_qmul, dw_qshift, dw_act, dw_param,
+        pw_weight, pw_bias, pw_qmul, pw_qshift, pw_act, pw_param,
+        frames, rows, cols, chans);
+}
+
+void cnn_net(
+    hls::stream<axis_t> &in_stream,
+    hls::stream<axis_t> &out_stream,
+    const wbus_t *w1,
+    bias_t b1[NET_C1],
+    qmul_t m1[NET_C1],
+    qshift_t s1[NET_C1],
+    act_t a1,
+    ap_uint<8> p1,
+    const wbus_t *w2,
+    bias_t b2[NET_C2],
+    qmul_t m2[NET_C2],
+    qshift_t s2[NET_C2],
+    act_t a2,
+    ap_uint<8> p2,
+    const wbus_t *w3,
+    bias_t b3[NET_C3],
+    qmul_t m3[NET_C3],
+    qshift_t s3[NET_C3],
+    act_t a3,
+    ap_uint<8> p3,
+    ap_uint<32> frames,
+    dim_t rows,
+    dim_t cols,
+    dim_t chans
+) {
+#pragma HLS INTERFACE axis port=in_stream
+#pragma HLS INTERFACE axis port=out_stream
+#pragma HLS INTERFACE m_axi port=w1 offset=slave bundle=gmem0 depth=NET_W1_DEPTH
+#pragma HLS INTERFACE s_axilite port=b1
+#pragma HLS INTERFACE s_axilite port=m1
+#pragma HLS INTERFACE s_axilite port=s1
+#pragma HLS INTERFACE s_axilite port=a1
+#pragma HLS INTERFACE s_axilite port=p1
+#pragma HLS INTERFACE m_axi port=w2 offset=slave bundle=gmem1 depth=NET_W2_DEPTH
+#pragma HLS INTERFACE s_axilite port=b2
+#pragma HLS INTERFACE s_axilite port=m2
+#pragma HLS INTERFACE s_axilite port=s2
+#pragma HLS INTERFACE s_axilite port=a2
+#pragma HLS INTERFACE s_axilite port=p2
+#pragma HLS INTERFACE m_axi port=w3 offset=slave bundle=gmem2 depth=NET_W3_DEPTH
+#pragma HLS INTERFACE s_axilite port=b3
+#pragma HLS INTERFACE s_axilite port=m3
+#pragma HLS INTERFACE s_axilite port=s3
+#pragma HLS INTERFACE s_axilite port=a3
+#pragma HLS INTERFACE s_axilite port=p3
+#pragma HLS INTERFACE s_axilite port=frames
+#pragma HLS INTERFACE s_axilite port=rows
+#pragma HLS INTERFACE s_axilite port=cols
+#pragma HLS INTERFACE s_axilite port=chans
+#pragma HLS INTERFACE ap_ctrl_chain port=return
 #pragma HLS INTERFACE s_axilite port=return
 
-    //л
-    static data_t linebuf[K][IN_W][IN_C];
-#pragma HLS ARRAY_PARTITION variable=linebuf complete dim=1
-#pragma HLS ARRAY_PARTITION variable=linebuf complete dim=3
-
-    for (int y = 0; y < IN_H; y++) {
-        for (int x = 0; x < IN_W; x++) {
-#pragma HLS PIPELINE II=1
-
-            data_t pixel[IN_C];
-#pragma HLS ARRAY_PARTITION variable=pixel complete
-
-            //ȡ3ͨ
-            for (int c = 0; c < IN_C; c++) {
-#pragma HLS UNROLL
-                axis_t tmp = in_stream.read();
-                pixel[c] = (data_t)tmp.data;
-            }
-
-            //л
-            for (int ky = K - 1; ky > 0; ky--) {
-                for (int c = 0; c < IN_C; c++) {
-#pragma HLS UNROLL
-                    linebuf[ky][x][c] = linebuf[ky - 1][x][c];
-                }
-            }
-
-            //д
-            for (int c = 0; c < IN_C; c++) {
-#pragma HLS UNROLL
-                linebuf[0][x][c] = pixel[c];
-            }
-
-            //
-            if (y >= K - 1 && x >= K - 1) {
-                acc_t sum = bias;
-
-                for (int ky = 0; ky < K; ky++) {
-                    for (int kx = 0; kx < K; kx++) {
-                        for (int c = 0; c < IN_C; c++) {
-#pragma HLS UNROLL
-                            sum += linebuf[ky][x - kx][c] *
-                                   weight[ky][kx][c];
-                        }
-                    }
-                }
-
-                axis_t out;
-                out.data = (ap_uint<8>)sum;
-                out.keep = -1;
-                out.last = (y == IN_H - 1 && x == IN_W - 1);
-                out_stream.write(out);
-            }
-        }
-    }
+    conv_chain3<net_l1, net_l2, net_l3, AXIS_W>(
+        in_stream, out_stream,
+        w1, b1, m1, s1, a1, p1,
+        w2, b2, m2, s2, a2, p2,
+        w3, b3, m3, s3, a3, p3, frames, rows, cols, chans);
 }
 
+void cnn_gemm_layer(
+    hls::stream<axis_t> &in_stream,
+    hls::stream<axis_t> &out_stream,
+    const wbus_t *weight,
+    bias_t bias[GEMM_N],
+    qmul_t qmul[GEMM_N],
+    qshift_t qshift[GEMM_N],
+    act_t act,
+    ap_uint<8> act_param,
+    ap_uint<32> m,
+    dim_t kd,
+    dim_t n
+) {
+#pragma HLS INTERFACE axis port=in_stream
+#pragma HLS INTERFACE axis port=out_stream
+#pragma HLS INTERFACE m_axi port=weight offset=slave bundle=gmem depth=GEMM_W_DEPTH
+#pragma HLS INTERFACE s_axilite port=bias
+#pragma HLS INTERFACE s_axilite port=qmul
+#pragma HLS INTERFACE s_axilite port=qshift
+#pragma HLS INTERFACE s_axilite port=act
+#pragma HLS INTERFACE s_axilite port=act_param
+#pragma HLS INTERFACE s_axilite port=m
+#pragma HLS INTERFACE s_axilite port=kd
+#pragma HLS INTERFACE s_axilite port=n
+#pragma HLS INTERFACE ap_ctrl_chain port=return
+#pragma HLS INTERFACE s_axilite port=return
+
+    gemm_axis<GEMM_PR, GEMM_PC, GEMM_K, GEMM_N, AXIS_W>(
+        in_stream, out_stream, weight, bias, qmul, qshift, act, act_param,
+        m, kd, n);
+}
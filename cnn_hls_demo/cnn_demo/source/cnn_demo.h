@@ -0,0 +1,1457 @@
+/*******************************************************************************
+MIT License
+
+Copyright (c) 2021 LEON-LINKS-room
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#ifndef __CNN_DEMO_H__
+#define __CNN_DEMO_H__
+
+#include <ap_int.h>
+#include <hls_stream.h>
+#include <ap_axi_sdata.h>
+
+//ߴ (, ʵʳߴɼĴ)
+//IN_W л, ͼ IN_W ֿ,
+//ص K-1 , һεðȫ
+#define IN_H   14
+#define IN_W   14
+#define IN_C   3
+#define OUT_C  4
+
+#define K      3
+
+//1: ʹ Winograd F(2x2,3x3) ʵ ( cnn_winograd.h), Ҫ K=3
+//ߴΪż; 0: ֱӷ
+#define CONV_WINOGRAD 0
+
+//1: ʹñʱ̶Ȩ (cnn_const.h е conv_bank), ȡ
+//weight ˿, Ҫ K=3, OUT_C=4, ֻ֧ valid,  1; 0: Ȩ m_axi 
+#define CONV_CONST_WEIGHTS 0
+
+//ϵ, Ч˳ߴΪ (K-1)*CONV_DIL+1;  (1/2) 벹ȦɼĴ,
+//Ϊ "same"  CONV_PAD_MAX Ȧ. Winograd ʵֻ֧ valid,  1
+#define CONV_DIL 1
+#define CONV_PAD_MAX (((K - 1) * CONV_DIL) / 2)
+
+//1: cnn_conv_layer ֻ AXI-Lite ܼ perf_in / perf_out (
+//axis_perf), ֱֻӷ; 0: ɼ߼
+#define CONV_PERF 0
+
+//valid,  1 ʱߴ
+#define OUT_H  (IN_H - K + 1)
+#define OUT_W  (IN_W - K + 1)
+
+//ںϳػ
+#define POOL_K 2
+#define POOL_S 2
+
+#define POOL_H ((OUT_H - POOL_K) / POOL_S + 1)
+#define POOL_W ((OUT_W - POOL_K) / POOL_S + 1)
+
+//ȿɷ (IN_C ͨ K x K, 㵽 OUT_C), 㼶ÿļ
+//PW_PAR ͨ, Ϊ OUT_C Լ
+#define PW_PAR 4
+
+//㼶, һΪ IN_H x IN_W x IN_C, ߴƳ
+#define NET_C1 4
+#define NET_K1 3
+#define NET_C2 8
+#define NET_K2 3
+#define NET_C3 4
+#define NET_K3 1
+
+// GEMM (ȫӲ 1x1 ,  cnn_gemm.h),  kd  n
+//, PE  GEMM_PR  x GEMM_PC ; GEMM_PC*8  WBUS_W һ
+//һ, ʱÿĶһȨ
+#define GEMM_K  256
+#define GEMM_N  64
+#define GEMM_PR 4
+#define GEMM_PC 8
+
+//AXI-Stream ݿ, 8 Ϊͨ, С IN_C*8 ʱÿĴ
+#define AXIS_W 32
+
+//Ȩ m_axi ߿, Ȩذ [co][ky][kx][c] ˳ÿִ WBUS_W/8 
+#define WBUS_W 64
+
+#define DATA_W 8
+
+/*
+ *  m_axi Ȩض˿ڵ,  INTERFACE  depth, C/RTL Эͬ
+ * ˷仺. ͬһ DATAFLOW веĶȨ̸һ
+ * bundle ( AXI ), һʱǻͬһִ.
+ */
+#define WBUS_WORDS(n)   (((n) * DATA_W + WBUS_W - 1) / WBUS_W)
+#define CONV_W_DEPTH    WBUS_WORDS(OUT_C * K * K * IN_C)
+#define DW_W_DEPTH      WBUS_WORDS(IN_C * K * K)
+#define PW_W_DEPTH      WBUS_WORDS(OUT_C * IN_C)
+#define NET_W1_DEPTH    WBUS_WORDS(NET_C1 * NET_K1 * NET_K1 * IN_C)
+#define NET_W2_DEPTH    WBUS_WORDS(NET_C2 * NET_K2 * NET_K2 * NET_C1)
+#define NET_W3_DEPTH    WBUS_WORDS(NET_C3 * NET_K3 * NET_K3 * NET_C2)
+#define GEMM_W_DEPTH    WBUS_WORDS(GEMM_K * ((GEMM_N + GEMM_PC - 1) / GEMM_PC) * GEMM_PC)
+
+//
+#define ACT_NONE   0
+#define ACT_RELU   1
+#define ACT_RELU6  2       //act_param Ϊ 6
+#define ACT_LEAKY  3       //act_param Ϊб, Q0.8
+
+//ػʽ
+#define POOL_MAX   0
+#define POOL_AVG   1
+
+//Ͷ
+typedef ap_int<DATA_W>  data_t;
+typedef ap_int<32> acc_t;
+typedef ap_int<32> bias_t;
+typedef ap_uint<16> qmul_t;
+typedef ap_uint<6>  qshift_t;
+typedef ap_uint<2>  act_t;
+typedef ap_uint<1>  pool_t;
+typedef ap_uint<2>  stride_t;
+typedef ap_uint<16> dim_t;
+typedef ap_uint<WBUS_W> wbus_t;
+typedef ap_axis<AXIS_W, 0, 0, 0> axis_t;
+
+/*
+ * rows / cols ʱߴ AXI-Lite Ĵ,  *_axis 
+ * [lo, hi]: ۺʱ hi ֵ hi , л岻Խ; Сڴ
+ * lo ֵ lo , . ͬ stride / pad .
+ */
+inline dim_t dim_clamp(dim_t v, int lo, int hi) {
+#pragma HLS INLINE
+    if (v < lo)
+        return lo;
+    else if (v > hi)
+        return hi;
+    return v;
+}
+
+//Ƭ: һصȫͨ, end һ֡һ
+//EW Ϊÿͨλ
+template<int C, int EW = DATA_W>
+struct pixel_pkt {
+    ap_uint<C * EW> data;
+    bool end;
+};
+
+/*
+ * ӿܼ, λΪʱ (ѭ II=1, ÿεһ)
+ *  stall Ϊ in_stream Ϊյ, Ϊ out_stream ;
+ *  cycles - beats - stall Ϊȴ.
+ */
+struct axis_perf {
+    ap_uint<32> beats;          //
+    ap_uint<32> stall;          //ȴⲿ
+    ap_uint<32> cycles;         //һĵ
+    ap_uint<32> frame_cycles;   //һ֡ (֮֡)
+};
+
+//ʱ ceil(log2(N))
+template<int N>
+struct clog2 {
+    static const int value = clog2<(N + 1) / 2>::value + 1;
+};
+
+template<>
+struct clog2<1> {
+    static const int value = 0;
+};
+
+/*
+ * ͨ·λ:  A_W, Ȩ W_W,  O_W, ƫ B_W, Ϊз
+ *  AXI-Stream ֽڴ, Ϊ 8 ı; ȨؿΪ.
+ */
+template<int A_W_, int W_W_, int O_W_, int B_W_>
+struct prec {
+    static const int A_W = A_W_;
+    static const int W_W = W_W_;
+    static const int O_W = O_W_;
+    static const int B_W = B_W_;
+};
+
+typedef prec<DATA_W, DATA_W, DATA_W, 32> prec_i8;
+
+/*
+ * ۼλ: N  PROD_W λ˻֮͵ľֵ N * 2^(PROD_W-2),
+ *  PROD_W-1+ceil(log2(N+1)) λɱʾ (SUM_W), ƫٶ 1 λ.
+ * ӷֻ SUM_W λ, ƫһ.
+ */
+template<int PROD_W, int B_W, int N>
+struct acc_width {
+    static const int SUM_W = PROD_W - 1 + clog2<N + 1>::value;
+    static const int ACC_W = ((SUM_W > B_W) ? SUM_W : B_W) + 1;
+};
+
+/*
+ * : ۼӽ * qmul >> qshift (, 0.5 ), , ͵
+ * O_W λз. ˻Ϊ ACC_W+16 λ (P_W), ֵ 2^(P_W-1),
+ * qshift >= P_W ʱΪ 0, ֱȡ 0,  qshift ȡ˻λ.
+ */
+template<int ACC_W, int O_W>
+ap_int<O_W> requant_w(
+    ap_int<ACC_W> acc,
+    qmul_t qmul,
+    qshift_t qshift,
+    act_t act,
+    ap_uint<8> act_param
+) {
+#pragma HLS INLINE
+    const int P_W = ACC_W + 16;
+    ap_int<P_W> prod = acc * qmul;
+
+    //(prod + 2^(s-1)) >> s  (prod >> s) ϱƳλ, 
+    ap_int<P_W> v = 0;
+    if (qshift < P_W) {
+        v = prod >> qshift;
+        if (qshift != 0 && prod[qshift - 1])
+            v++;
+    }
+
+    if (v < 0) {
+        if (act == ACT_RELU || act == ACT_RELU6) {
+            v = 0;
+        }
+        else if (act == ACT_LEAKY) {
+            ap_int<P_W + 8> t = v * act_param;
+            v = (t >> 8) + (t[7] ? 1 : 0);
+        }
+    }
+    if (act == ACT_RELU6 && v > act_param)
+        v = act_param;
+
+    const ap_int<P_W> O_MAX = (ap_int<P_W>(1) << (O_W - 1)) - 1;
+    const ap_int<P_W> O_MIN = -(ap_int<P_W>(1) << (O_W - 1));
+    if (v > O_MAX)
+        v = O_MAX;
+    else if (v < O_MIN)
+        v = O_MIN;
+
+    return (ap_int<O_W>)v;
+}
+
+//int8 , 32 λۼ (ͨ Winograd ʹ)
+inline data_t requant(
+    acc_t acc,
+    qmul_t qmul,
+    qshift_t qshift,
+    act_t act,
+    ap_uint<8> act_param
+) {
+#pragma HLS INLINE
+    return requant_w<32, DATA_W>(acc, qmul, qshift, act, act_param);
+}
+
+/*
+ * AXI-Stream  -> 
+ * ÿ BUS_W/EW ͨ. ͨ C ʱ, һĴ (BUS_W/EW)/C 
+ * , ֽΪ; һռ ceil(C/(BUS_W/EW)) .
+ * BUS_W=8 ԭͨһĵĸʽ. ÿ֡µһĿʼ.
+ * frames Ϊ 0 ʱ frames ֡,  TLAST ; Ϊ 0 ʱһֱ
+ * һĴ TLAST һ֡Ϊֹ. ÿ֡ n ,  MAX_N.
+ * PERF ΪʱȲѯ in_stream ǷΪ, Ϊյֻ perf.stall.
+ */
+template<int MAX_N, int C, int BUS_W, int EW, bool PERF>
+void axis_unpack_perf(
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > &in_stream,
+    hls::stream<pixel_pkt<C, EW> > &pix_stream,
+    ap_uint<32> frames,
+    ap_uint<32> n,
+    axis_perf &perf
+) {
+    typedef char ew_check[(EW % 8 == 0 && EW <= BUS_W) ? 1 : -1];
+    const int LANES = BUS_W / EW;
+    const int PIX_W = C * EW;
+
+    int i = 0;
+    ap_uint<32> f = 0;
+    bool end = false;
+    ap_uint<32> beats = 0;
+    ap_uint<32> stall = 0;
+    ap_uint<32> cycles = 0;
+    ap_uint<32> frame_start = 0;
+    ap_uint<32> frame_cycles = 0;
+
+    if (LANES >= C) {
+        const int PPB = LANES / C;
+        ap_axis<BUS_W, 0, 0, 0> beat;
+        int lane = 0;
+
+        while (!end) {
+#pragma HLS PIPELINE II=1
+#pragma HLS LOOP_TRIPCOUNT min=1 max=MAX_N
+            bool ready = !PERF || lane != 0 || !in_stream.empty();
+            if (PERF) {
+                cycles++;
+                if (!ready)
+                    stall++;
+            }
+            if (ready) {
+                if (lane == 0) {
+                    beat = in_stream.read();
+                    beats++;
+                }
+
+                bool frame_end = (i == n - 1);
+                pixel_pkt<C, EW> pix;
+                pix.data = beat.data.range(lane * PIX_W + PIX_W - 1,
+                                           lane * PIX_W);
+                pix.end = frame_end &&
+                          ((frames != 0) ? (f == frames - 1) : (bool)beat.last);
+                pix_stream.write(pix);
+
+                lane = (lane == PPB - 1 || frame_end) ? 0 : lane + 1;
+                i = frame_end ? 0 : i + 1;
+                if (frame_end) {
+                    f++;
+                    frame_cycles = cycles - frame_start;
+                    frame_start = cycles;
+                }
+                end = pix.end;
+            }
+        }
+    }
+    else {
+        const int BPP = (C + LANES - 1) / LANES;
+        const int MAX_BEATS = MAX_N * BPP;
+        ap_uint<BPP * BUS_W> word;
+        int b = 0;
+
+        while (!end) {
+#pragma HLS PIPELINE II=1
+#pragma HLS LOOP_TRIPCOUNT min=1 max=MAX_BEATS
+            bool ready = !PERF || !in_stream.empty();
+            if (PERF) {
+                cycles++;
+                if (!ready)
+                    stall++;
+            }
+            if (ready) {
+                ap_axis<BUS_W, 0, 0, 0> beat = in_stream.read();
+                beats++;
+                word.range(b * BUS_W + BUS_W - 1, b * BUS_W) = beat.data;
+
+                if (b == BPP - 1) {
+                    bool frame_end = (i == n - 1);
+                    pixel_pkt<C, EW> pix;
+                    pix.data = word.range(PIX_W - 1, 0);
+                    pix.end = frame_end &&
+                              ((frames != 0) ? (f == frames - 1)
+                                             : (bool)beat.last);
+                    pix_stream.write(pix);
+
+                    i = frame_end ? 0 : i + 1;
+                    if (frame_end) {
+                        f++;
+                        frame_cycles = cycles - frame_start;
+                        frame_start = cycles;
+                    }
+                    end = pix.end;
+                    b = 0;
+                }
+                else {
+                    b++;
+                }
+            }
+        }
+    }
+
+    if (PERF) {
+        perf.beats = beats;
+        perf.stall = stall;
+        perf.cycles = cycles;
+        perf.frame_cycles = frame_cycles;
+    }
+}
+
+//Ĳ, ߼ڱʱȥ
+template<int MAX_N, int C, int BUS_W, int EW>
+void axis_unpack(
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > &in_stream,
+    hls::stream<pixel_pkt<C, EW> > &pix_stream,
+    ap_uint<32> frames,
+    ap_uint<32> n
+) {
+#pragma HLS INLINE
+    axis_perf perf;
+    axis_unpack_perf<MAX_N, C, BUS_W, EW, false>(in_stream, pix_stream,
+                                                 frames, n, perf);
+}
+
+/*
+ *  -> AXI-Stream , ʽ axis_unpack ͬ
+ * ֽ keep Ϊ 0, ÿ֡ n , һ TLAST, յ end .
+ * PERF ΪʱȲѯ pix_stream Ƿءout_stream Ƿ, ߶
+ * ǰ; Ҫд out_stream ڼ perf.stall.
+ */
+template<int MAX_N, int C, int BUS_W, int EW, bool PERF>
+void axis_pack_perf(
+    hls::stream<pixel_pkt<C, EW> > &pix_stream,
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > &out_stream,
+    ap_uint<32> n,
+    axis_perf &perf
+) {
+    typedef char ew_check[(EW % 8 == 0 && EW <= BUS_W) ? 1 : -1];
+    const int LANES = BUS_W / EW;
+    const int PIX_W = C * EW;
+    const int EB = EW / 8;
+
+    int i = 0;
+    bool end = false;
+    ap_uint<32> beats = 0;
+    ap_uint<32> stall = 0;
+    ap_uint<32> cycles = 0;
+    ap_uint<32> frame_start = 0;
+    ap_uint<32> frame_cycles = 0;
+
+    if (LANES >= C) {
+        const int PPB = LANES / C;
+        ap_axis<BUS_W, 0, 0, 0> beat;
+        beat.data = 0;
+        beat.keep = 0;
+        int lane = 0;
+
+        while (!end) {
+#pragma HLS PIPELINE II=1
+#pragma HLS LOOP_TRIPCOUNT min=1 max=MAX_N
+            bool frame_end = (i == n - 1);
+            bool flush = (lane == PPB - 1 || frame_end);
+            bool in_ok = !PERF || !pix_stream.empty();
+            bool out_ok = !PERF || !flush || !out_stream.full();
+            if (PERF) {
+                cycles++;
+                if (in_ok && !out_ok)
+                    stall++;
+            }
+            if (in_ok && out_ok) {
+                pixel_pkt<C, EW> pix = pix_stream.read();
+                beat.data.range(lane * PIX_W + PIX_W - 1, lane * PIX_W) =
+                    pix.data;
+                beat.keep.range((lane + 1) * C * EB - 1, lane * C * EB) = -1;
+
+                if (flush) {
+                    beat.last = frame_end;
+                    out_stream.write(beat);
+                    beats++;
+                    beat.data = 0;
+                    beat.keep = 0;
+                    lane = 0;
+                }
+                else {
+                    lane++;
+                }
+                if (frame_end) {
+                    frame_cycles = cycles - frame_start;
+                    frame_start = cycles;
+                }
+                i = frame_end ? 0 : i + 1;
+                end = pix.end;
+            }
+        }
+    }
+    else {
+        const int BPP = (C + LANES - 1) / LANES;
+        const int MAX_BEATS = MAX_N * BPP;
+        ap_uint<BPP * BUS_W> word;
+        bool pix_end = false;
+        int b = 0;
+
+        while (!end) {
+#pragma HLS PIPELINE II=1
+#pragma HLS LOOP_TRIPCOUNT min=1 max=MAX_BEATS
+            bool in_ok = !PERF || b != 0 || !pix_stream.empty();
+            bool out_ok = !PERF || !out_stream.full();
+            if (PERF) {
+                cycles++;
+                if (in_ok && !out_ok)
+                    stall++;
+            }
+            if (in_ok && out_ok) {
+                if (b == 0) {
+                    pixel_pkt<C, EW> pix = pix_stream.read();
+                    word = pix.data;
+                    pix_end = pix.end;
+                }
+
+                ap_axis<BUS_W, 0, 0, 0> beat;
+                beat.data = word.range(b * BUS_W + BUS_W - 1, b * BUS_W);
+                beat.keep = 0;
+                for (int l = 0; l < BUS_W / 8; l++) {
+#pragma HLS UNROLL
+                    beat.keep[l] = (b * LANES * EB + l < C * EB);
+                }
+                beat.last = (i == n - 1 && b == BPP - 1);
+                out_stream.write(beat);
+                beats++;
+
+                if (b == BPP - 1) {
+                    if (i == n - 1) {
+                        frame_cycles = cycles - frame_start;
+                        frame_start = cycles;
+                    }
+                    i = (i == n - 1) ? 0 : i + 1;
+                    b = 0;
+                    end = pix_end;
+                }
+                else {
+                    b++;
+                }
+            }
+        }
+    }
+
+    if (PERF) {
+        perf.beats = beats;
+        perf.stall = stall;
+        perf.cycles = cycles;
+        perf.frame_cycles = frame_cycles;
+    }
+}
+
+//Ĵ
+template<int MAX_N, int C, int BUS_W, int EW>
+void axis_pack(
+    hls::stream<pixel_pkt<C, EW> > &pix_stream,
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > &out_stream,
+    ap_uint<32> n
+) {
+#pragma HLS INLINE
+    axis_perf perf;
+    axis_pack_perf<MAX_N, C, BUS_W, EW, false>(pix_stream, out_stream, n, perf);
+}
+
+/*
+ * л뻬 (ػ)
+ * лֻǰ KS-1 , кת, ÿд洢ÿֻ
+ * һζһд; ΪĴ, ÿһ. 洢
+ * ӷָ, top ָһڵ, row_end ʾǰΪĩ.
+ */
+template<int W, int C, int KS, int EW>
+void window_shift(
+    ap_uint<C * EW> pixel,
+    int x,
+    bool row_end,
+    ap_uint<C * EW> linebuf[(KS > 1) ? KS - 1 : 1][W],
+    int &top,
+    ap_int<EW> window[KS][KS][C]
+) {
+#pragma HLS INLINE
+    const int LB_ROWS = (KS > 1) ? KS - 1 : 1;
+
+    //ȡǰ, ǰ KS-1 л, һΪ
+    ap_uint<C * EW> col[KS];
+#pragma HLS ARRAY_PARTITION variable=col complete
+    for (int r = 0; r < KS - 1; r++) {
+#pragma HLS UNROLL
+        int idx = top + r;
+        if (idx >= LB_ROWS)
+            idx -= LB_ROWS;
+        col[r] = linebuf[idx][x];
+    }
+    col[KS - 1] = pixel;
+
+    //ظһ, ĩתк
+    if (KS > 1) {
+        linebuf[top][x] = pixel;
+        if (row_end)
+            top = (top == LB_ROWS - 1) ? 0 : top + 1;
+    }
+
+    //һ, дҲ
+    for (int ky = 0; ky < KS; ky++) {
+#pragma HLS UNROLL
+        for (int kx = 0; kx < KS - 1; kx++) {
+            for (int c = 0; c < C; c++) {
+                window[ky][kx][c] = window[ky][kx + 1][c];
+            }
+        }
+        for (int c = 0; c < C; c++) {
+            window[ky][KS - 1][c] = col[ky].range(c * EW + EW - 1, c * EW);
+        }
+    }
+}
+
+/*
+ * : ÿ֡ܲ pad Ȧ,  (rows+2pad) x (cols+2pad)
+ * ֻڲλöȡ, ־Ƶһ. pad  P.
+ */
+template<int H, int W, int C, int P>
+void pad_stream(
+    hls::stream<pixel_pkt<C> > &in_stream,
+    hls::stream<pixel_pkt<C> > &out_stream,
+    dim_t rows,
+    dim_t cols,
+    dim_t pad
+) {
+    const int MAX_PIX = (H + 2 * P) * (W + 2 * P);
+    dim_t prows = rows + 2 * pad;
+    dim_t pcols = cols + 2 * pad;
+
+    bool last_frame = false;
+    int x = 0;
+    int y = 0;
+    bool end = false;
+
+    while (!end) {
+#pragma HLS PIPELINE II=1
+#pragma HLS LOOP_TRIPCOUNT min=1 max=MAX_PIX
+
+        bool inside = (y >= pad && y < pad + rows && x >= pad && x < pad + cols);
+        bool row_end = (x == pcols - 1);
+        bool frame_end = (row_end && y == prows - 1);
+
+        pixel_pkt<C> pix;
+        pix.data = 0;
+        if (inside) {
+            pix = in_stream.read();
+            last_frame = pix.end;
+        }
+        pix.end = frame_end && last_frame;
+        out_stream.write(pix);
+
+        end = pix.end;
+        if (row_end) {
+            x = 0;
+            y = frame_end ? 0 : y + 1;
+        }
+        else {
+            x++;
+        }
+    }
+}
+
+/*
+ * Ȩ:  m_axi ͻȡ N ȨصƬϻ
+ *  DATAFLOW д, ۺΪƹһ, һεõȨ
+ * 뱾μص. ÿִ WBUS_W/EW  EW λȨ.
+ */
+template<int N, int EW>
+void weight_load(
+    const wbus_t *src,
+    ap_int<EW> dst[N]
+) {
+    const int LANES = WBUS_W / EW;
+    const int WORDS = (N + LANES - 1) / LANES;
+
+    for (int i = 0; i < WORDS; i++) {
+#pragma HLS PIPELINE II=1
+        wbus_t word = src[i];
+        for (int l = 0; l < LANES; l++) {
+#pragma HLS UNROLL
+            if (i * LANES + l < N)
+                dst[i * LANES + l] = word.range(l * EW + EW - 1, l * EW);
+        }
+    }
+}
+
+/*
+ * ڵĳۼ, Ȩ weight_load õƬϻ
+ * ۼṩ߸Ȩλ W_WȨػС, Լ
+ * mac<SUM_W, A_W, E, DIL>(window, weight, co):  co ͨ E x E
+ * ϰ DIL ȡͷĳ˻֮, Ϊ SUM_W λ. Ȩؼ
+ * cnn_const.h  naf_mac.
+ */
+template<int C_IN, int C_OUT, int KS, int W_W_>
+struct buf_mac {
+    static const int W_W = W_W_;
+    static const int WEIGHTS = C_OUT * KS * KS * C_IN;
+    typedef ap_int<W_W> weight_t;
+
+    template<int SUM_W, int A_W, int E, int DIL>
+    static ap_int<SUM_W> mac(
+        ap_int<A_W> window[E][E][C_IN],
+        weight_t weight[WEIGHTS],
+        int co
+    ) {
+#pragma HLS INLINE
+        ap_int<SUM_W> sum = 0;
+
+        for (int ky = 0; ky < KS; ky++) {
+            for (int kx = 0; kx < KS; kx++) {
+                for (int c = 0; c < C_IN; c++) {
+#pragma HLS UNROLL
+                    sum += window[ky * DIL][kx * DIL][c] *
+                           weight[((co * KS + ky) * KS + kx) * C_IN + c];
+                }
+            }
+        }
+        return sum;
+    }
+};
+
+/*
+ * ͨ
+ * rows x cols , ÿݰһصȫͨ, 
+ * C_OUT ˹ͬһл, һα뼴ɵõȫͨ, ÿ
+ * ͬΪһ. ͬߴʵ, л廥.
+ * ۼӽ requant šͺֱ int8.
+ * H / W / C_IN ۺʱ, ʱߴ KS <= rows <= H,
+ * KS <= cols <= W, chans <= C_IN,  chans ֮ͨ 0 .
+ * ÿڵĳۼ MAC  ( buf_mac), weight ΪȨػ.
+ *  DIL: Ϊ E = (KS-1)*DIL+1, ͷ DIL, л E-1 .
+ *  stride Ϊ 1  2, ֻڲ; ÿ֡һ֡βʱ
+ * ݴ浽֡βٴ end  (ͬ pool_engine).
+ *  /  / ƫλɶ˿Ƴ, ӷ acc_width ȡС
+ * λ, int8 ֮ϼ conv_prec_axis.
+ */
+template<int H, int W, int C_IN, int C_OUT, int KS, int DIL, class MAC,
+         int A_W, int O_W, int B_W>
+void conv_mac_engine(
+    hls::stream<pixel_pkt<C_IN, A_W> > &in_stream,
+    hls::stream<pixel_pkt<C_OUT, O_W> > &out_stream,
+    typename MAC::weight_t weight[MAC::WEIGHTS],
+    ap_int<B_W> bias[C_OUT],
+    qmul_t qmul[C_OUT],
+    qshift_t qshift[C_OUT],
+    act_t act,
+    ap_uint<8> act_param,
+    dim_t rows,
+    dim_t cols,
+    dim_t chans,
+    stride_t stride
+) {
+    const int MAX_PIX = H * W;
+    const int E = (KS - 1) * DIL + 1;
+    typedef acc_width<A_W + MAC::W_W, B_W, KS * KS * C_IN> ACC;
+
+    //ƫϵĴ
+    ap_int<B_W> b_local[C_OUT];
+#pragma HLS ARRAY_PARTITION variable=b_local complete
+    qmul_t m_local[C_OUT];
+#pragma HLS ARRAY_PARTITION variable=m_local complete
+    qshift_t s_local[C_OUT];
+#pragma HLS ARRAY_PARTITION variable=s_local complete
+
+    for (int co = 0; co < C_OUT; co++) {
+#pragma HLS PIPELINE II=1
+        b_local[co] = bias[co];
+        m_local[co] = qmul[co];
+        s_local[co] = qshift[co];
+    }
+
+    //л뻬, window[0][0] ΪϽ
+    const int LB_ROWS = (E > 1) ? E - 1 : 1;
+    static ap_uint<C_IN * A_W> linebuf[LB_ROWS][W];
+#pragma HLS ARRAY_PARTITION variable=linebuf complete dim=1
+#pragma HLS RESOURCE variable=linebuf core=RAM_2P_BRAM
+#pragma HLS DEPENDENCE variable=linebuf inter false
+    static int top = 0;
+    static ap_int<A_W> window[E][E][C_IN];
+#pragma HLS ARRAY_PARTITION variable=window complete dim=0
+
+    //ÿ֡һλ, Ϊ 2 ʱżƫ
+    dim_t y_last = (stride == 2) ? (dim_t)(E - 1 + ((rows - E) & ~1)) : (dim_t)(rows - 1);
+    dim_t x_last = (stride == 2) ? (dim_t)(E - 1 + ((cols - E) & ~1)) : (dim_t)(cols - 1);
+    pixel_pkt<C_OUT, O_W> held;
+
+    //֡, ֡ʱˮ߲ſ.
+    //ÿ֡ǰ E-1 в, лһ֡ľݲ.
+    int x = 0;
+    int y = 0;
+    bool end = false;
+
+    while (!end) {
+#pragma HLS PIPELINE II=1
+#pragma HLS LOOP_TRIPCOUNT min=1 max=MAX_PIX
+
+        //ȡһصͨ, δõͨ
+        pixel_pkt<C_IN, A_W> pixel = in_stream.read();
+        for (int c = 0; c < C_IN; c++) {
+#pragma HLS UNROLL
+            if (c >= chans)
+                pixel.data.range(c * A_W + A_W - 1, c * A_W) = 0;
+        }
+
+        bool row_end = (x == cols - 1);
+        window_shift<W, C_IN, E>(pixel.data, x, row_end, linebuf, top, window);
+
+        bool frame_end = (row_end && y == rows - 1);
+        bool on_grid = (stride == 1) ||
+                       (((y - (E - 1)) & 1) == 0 && ((x - (E - 1)) & 1) == 0);
+
+        //, ϽΪ (y-E+1, x-E+1)
+        if (y >= E - 1 && x >= E - 1 && on_grid) {
+            pixel_pkt<C_OUT, O_W> out;
+
+            for (int co = 0; co < C_OUT; co++) {
+#pragma HLS UNROLL
+                ap_int<ACC::SUM_W> sum =
+                    MAC::template mac<ACC::SUM_W, A_W, E, DIL>(window, weight, co);
+                ap_int<ACC::ACC_W> acc = sum + b_local[co];
+
+                out.data.range(co * O_W + O_W - 1, co * O_W) =
+                    (ap_uint<O_W>)requant_w<ACC::ACC_W, O_W>(
+                        acc, m_local[co], s_local[co], act, act_param);
+            }
+
+            out.end = pixel.end;
+            if (y == y_last && x == x_last && !frame_end)
+                held = out;
+            else
+                out_stream.write(out);
+        }
+        else if (frame_end) {
+            held.end = pixel.end;
+            out_stream.write(held);
+        }
+
+        end = pixel.end;
+        if (row_end) {
+            x = 0;
+            y = (y == rows - 1) ? 0 : y + 1;
+        }
+        else {
+            x++;
+        }
+    }
+}
+
+//ȨƬϻеľ, ˿Ƴλ
+template<int H, int W, int C_IN, int C_OUT, int KS, int DIL,
+         int A_W, int W_W, int O_W, int B_W>
+void conv_engine(
+    hls::stream<pixel_pkt<C_IN, A_W> > &in_stream,
+    hls::stream<pixel_pkt<C_OUT, O_W> > &out_stream,
+    ap_int<W_W> weight[C_OUT * KS * KS * C_IN],
+    ap_int<B_W> bias[C_OUT],
+    qmul_t qmul[C_OUT],
+    qshift_t qshift[C_OUT],
+    act_t act,
+    ap_uint<8> act_param,
+    dim_t rows,
+    dim_t cols,
+    dim_t chans,
+    stride_t stride
+) {
+#pragma HLS INLINE
+    conv_mac_engine<H, W, C_IN, C_OUT, KS, DIL, buf_mac<C_IN, C_OUT, KS, W_W> >(
+        in_stream, out_stream, weight, bias, qmul, qshift, act, act_param,
+        rows, cols, chans, stride);
+}
+
+/*
+ * ػ, PK x PK ,  PS
+ * ͬлṹ, ֻ PK-1 . ƽػ 0.5 ȡ.
+ * Ϊ rows x cols,  H x W.
+ */
+template<int H, int W, int C, int PK, int PS>
+void pool_engine(
+    hls::stream<pixel_pkt<C> > &in_stream,
+    hls::stream<pixel_pkt<C> > &out_stream,
+    pool_t mode,
+    dim_t rows,
+    dim_t cols
+) {
+    const int MAX_PIX = H * W;
+    const int LB_ROWS = (PK > 1) ? PK - 1 : 1;
+    static ap_uint<C * DATA_W> linebuf[LB_ROWS][W];
+#pragma HLS ARRAY_PARTITION variable=linebuf complete dim=1
+#pragma HLS RESOURCE variable=linebuf core=RAM_2P_BRAM
+#pragma HLS DEPENDENCE variable=linebuf inter false
+    static int top = 0;
+    static data_t window[PK][PK][C];
+#pragma HLS ARRAY_PARTITION variable=window complete dim=0
+
+    //ÿ֡һλ, ֡βʱݴ浽֡βٴ end 
+    dim_t y_last = PK - 1 + (rows - PK) / PS * PS;
+    dim_t x_last = PK - 1 + (cols - PK) / PS * PS;
+    pixel_pkt<C> held;
+
+    int x = 0;
+    int y = 0;
+    bool end = false;
+
+    while (!end) {
+#pragma HLS PIPELINE II=1
+#pragma HLS LOOP_TRIPCOUNT min=1 max=MAX_PIX
+
+        pixel_pkt<C> pixel = in_stream.read();
+        bool row_end = (x == cols - 1);
+        window_shift<W, C, PK>(pixel.data, x, row_end, linebuf, top, window);
+
+        bool frame_end = (row_end && y == rows - 1);
+
+        //ڲʱ
+        if (y >= PK - 1 && x >= PK - 1 &&
+            (y - (PK - 1)) % PS == 0 && (x - (PK - 1)) % PS == 0) {
+            pixel_pkt<C> out;
+
+            for (int c = 0; c < C; c++) {
+#pragma HLS UNROLL
+                data_t max_val = window[0][0][c];
+                ap_int<DATA_W + 8> sum = 0;
+
+                for (int ky = 0; ky < PK; ky++) {
+                    for (int kx = 0; kx < PK; kx++) {
+                        if (window[ky][kx][c] > max_val)
+                            max_val = window[ky][kx][c];
+                        sum += window[ky][kx][c];
+                    }
+                }
+
+                //round(sum / n) = floor((2*sum + n) / (2*n))
+                data_t res = max_val;
+                if (mode == POOL_AVG) {
+                    ap_int<DATA_W + 10> num = 2 * sum + PK * PK;
+                    ap_int<DATA_W + 10> q = num / (2 * PK * PK);
+                    if (q * (2 * PK * PK) > num)
+                        q--;
+                    res = q;
+                }
+
+                out.data.range(c * DATA_W + DATA_W - 1, c * DATA_W) =
+                    (ap_uint<DATA_W>)res;
+            }
+
+            out.end = pixel.end;
+            if (y == y_last && x == x_last && !frame_end)
+                held = out;
+            else
+                out_stream.write(out);
+        }
+        else if (frame_end) {
+            held.end = pixel.end;
+            out_stream.write(held);
+        }
+
+        end = pixel.end;
+        if (row_end) {
+            x = 0;
+            y = (y == rows - 1) ? 0 : y + 1;
+        }
+        else {
+            x++;
+        }
+    }
+}
+
+/*
+ * λϵľ:  ->  -> , ˮ
+ * P Ϊ prec<A_W, W_W, O_W, B_W>: ÿͨ A_W λ, ÿͨ O_W λ,
+ * Ȩذ W_W λܴ (ÿ m_axi  WBUS_W/W_W ), ƫ B_W λ.
+ * ˷ӷ A_W + W_W С, խ˷ LUT ʵԽʡ DSP.
+ * rows / cols  dim_clamp  [KS, H] / [KS, W].
+ */
+template<int H, int W, int C_IN, int C_OUT, int KS, class P, int BUS_W>
+void conv_prec_axis(
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > &in_stream,
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > &out_stream,
+    const wbus_t *weight,
+    ap_int<P::B_W> bias[C_OUT],
+    qmul_t qmul[C_OUT],
+    qshift_t qshift[C_OUT],
+    act_t act,
+    ap_uint<8> act_param,
+    ap_uint<32> frames,
+    dim_t rows,
+    dim_t cols,
+    dim_t chans
+) {
+#pragma HLS DATAFLOW
+    dim_t nrows = dim_clamp(rows, KS, H);
+    dim_t ncols = dim_clamp(cols, KS, W);
+    ap_uint<32> out_pix_n = (nrows - KS + 1) * (ncols - KS + 1);
+
+    ap_int<P::W_W> w_buf[C_OUT * KS * KS * C_IN];
+#pragma HLS ARRAY_PARTITION variable=w_buf complete
+    hls::stream<pixel_pkt<C_IN, P::A_W> > in_pix;
+    hls::stream<pixel_pkt<C_OUT, P::O_W> > out_pix;
+#pragma HLS STREAM variable=in_pix depth=2
+#pragma HLS STREAM variable=out_pix depth=2
+
+    weight_load<C_OUT * KS * KS * C_IN>(weight, w_buf);
+    axis_unpack<H * W, C_IN, BUS_W>(in_stream, in_pix, frames, nrows * ncols);
+    conv_engine<H, W, C_IN, C_OUT, KS, 1>(in_pix, out_pix, w_buf, bias,
+                                          qmul, qshift, act, act_param,
+                                          nrows, ncols, chans, 1);
+    axis_pack<(H - KS + 1) * (W - KS + 1), C_OUT, BUS_W>(out_pix, out_stream,
+                                                         out_pix_n);
+}
+
+/*
+ * AXI-Stream ӿڵľ:  ->  -> , ˮ
+ * ÿٳһʱ, ѭÿһ.
+ * һεһ֡ ( axis_unpack  frames), ÿ֡ TLAST.
+ * ߴ rows / cols / chans , ģֻ, rows / cols
+ *  dim_clamp  [KS, H] / [KS, W].
+ * Ȩؾ m_axi , ʽ weight_load.
+ *  prec_i8  conv_prec_axis.
+ */
+template<int H, int W, int C_IN, int C_OUT, int KS, int BUS_W>
+void conv_axis(
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > &in_stream,
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > &out_stream,
+    const wbus_t *weight,
+    bias_t bias[C_OUT],
+    qmul_t qmul[C_OUT],
+    qshift_t qshift[C_OUT],
+    act_t act,
+    ap_uint<8> act_param,
+    ap_uint<32> frames,
+    dim_t rows,
+    dim_t cols,
+    dim_t chans
+) {
+#pragma HLS INLINE
+    conv_prec_axis<H, W, C_IN, C_OUT, KS, prec_i8, BUS_W>(
+        in_stream, out_stream, weight, bias, qmul, qshift, act, act_param,
+        frames, rows, cols, chans);
+}
+
+/*
+ * 㡢͵ľ:  ->  ->  -> 
+ * 벽ȡ, ԤȲºȡ.
+ * pad ΪܲȦ (<= PMAX, "same" Ϊ (KS-1)*DIL/2), stride Ϊ 1  2.
+ *  ((rows + 2pad - E) / stride + 1) x ((cols + 2pad - E) / stride + 1),
+ * E = (KS-1)*DIL+1.
+ * stride / pad  AXI-Lite Ĵ, ǷֵĺϷֵ: stride Ϊ
+ * 2 ʱ 1 (0  3  1), pad  PMAX ʱ PMAX, л岻Խ.
+ * rows / cols  dim_clamp ,  H / W, ʹС E.
+ */
+template<int H, int W, int C_IN, int C_OUT, int KS, int DIL, int PMAX, int BUS_W,
+         bool PERF>
+void conv_ext_perf_axis(
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > &in_stream,
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > &out_stream,
+    const wbus_t *weight,
+    bias_t bias[C_OUT],
+    qmul_t qmul[C_OUT],
+    qshift_t qshift[C_OUT],
+    act_t act,
+    ap_uint<8> act_param,
+    ap_uint<32> frames,
+    dim_t rows,
+    dim_t cols,
+    dim_t chans,
+    stride_t stride,
+    dim_t pad,
+    axis_perf &perf_in,
+    axis_perf &perf_out
+) {
+#pragma HLS DATAFLOW
+    const int E = (KS - 1) * DIL + 1;
+    const int HP = H + 2 * PMAX;
+    const int WP = W + 2 * PMAX;
+    stride_t st = (stride == 2) ? 2 : 1;
+    dim_t pd = (pad > PMAX) ? (dim_t)PMAX : pad;
+    int lo = E - 2 * pd.to_int();
+    if (lo < 1)
+        lo = 1;
+    dim_t nrows = dim_clamp(rows, lo, H);
+    dim_t ncols = dim_clamp(cols, lo, W);
+    dim_t prows = nrows + 2 * pd;
+    dim_t pcols = ncols + 2 * pd;
+    ap_uint<32> out_pix_n = (((prows - E) >> (st - 1)) + 1) *
+                            (((pcols - E) >> (st - 1)) + 1);
+
+    data_t w_buf[C_OUT * KS * KS * C_IN];
+#pragma HLS ARRAY_PARTITION variable=w_buf complete
+    hls::stream<pixel_pkt<C_IN> > in_pix;
+    hls::stream<pixel_pkt<C_IN> > pad_pix;
+    hls::stream<pixel_pkt<C_OUT> > out_pix;
+#pragma HLS STREAM variable=in_pix depth=2
+#pragma HLS STREAM variable=pad_pix depth=2
+#pragma HLS STREAM variable=out_pix depth=2
+
+    weight_load<C_OUT * KS * KS * C_IN>(weight, w_buf);
+    axis_unpack_perf<H * W, C_IN, BUS_W, DATA_W, PERF>(in_stream, in_pix,
+                                                       frames, nrows * ncols,
+                                                       perf_in);
+    pad_stream<H, W, C_IN, PMAX>(in_pix, pad_pix, nrows, ncols, pd);
+    conv_engine<HP, WP, C_IN, C_OUT, KS, DIL>(pad_pix, out_pix, w_buf, bias,
+                                              qmul, qshift, act, act_param,
+                                              prows, pcols, chans, st);
+    axis_pack_perf<(HP - E + 1) * (WP - E + 1), C_OUT, BUS_W, DATA_W, PERF>(
+        out_pix, out_stream, out_pix_n, perf_out);
+}
+
+//ܼİ汾
+template<int H, int W, int C_IN, int C_OUT, int KS, int DIL, int PMAX, int BUS_W>
+void conv_ext_axis(
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > &in_stream,
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > &out_stream,
+    const wbus_t *weight,
+    bias_t bias[C_OUT],
+    qmul_t qmul[C_OUT],
+    qshift_t qshift[C_OUT],
+    act_t act,
+    ap_uint<8> act_param,
+    ap_uint<32> frames,
+    dim_t rows,
+    dim_t cols,
+    dim_t chans,
+    stride_t stride,
+    dim_t pad
+) {
+    axis_perf perf_in;
+    axis_perf perf_out;
+    conv_ext_perf_axis<H, W, C_IN, C_OUT, KS, DIL, PMAX, BUS_W, false>(
+        in_stream, out_stream, weight, bias, qmul, qshift, act, act_param,
+        frames, rows, cols, chans, stride, pad, perf_in, perf_out);
+}
+
+/*
+ *  + ػں:  ->  -> ػ -> 
+ * мֻƬ FIFO, ֻгػͼ뿪оƬ.
+ * rows / cols  dim_clamp , Ϊһػ.
+ */
+template<int H, int W, int C_IN, int C_OUT, int KS, int PK, int PS, int BUS_W>
+void conv_pool_axis(
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > &in_stream,
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > &out_stream,
+    const wbus_t *weight,
+    bias_t bias[C_OUT],
+    qmul_t qmul[C_OUT],
+    qshift_t qshift[C_OUT],
+    act_t act,
+    ap_uint<8> act_param,
+    pool_t pool_mode,
+    ap_uint<32> frames,
+    dim_t rows,
+    dim_t cols,
+    dim_t chans
+) {
+#pragma HLS DATAFLOW
+    const int CH = H - KS + 1;
+    const int CW = W - KS + 1;
+    dim_t nrows = dim_clamp(rows, KS + PK - 1, H);
+    dim_t ncols = dim_clamp(cols, KS + PK - 1, W);
+    dim_t conv_rows = nrows - KS + 1;
+    dim_t conv_cols = ncols - KS + 1;
+    ap_uint<32> out_pix_n =
+        ((conv_rows - PK) / PS + 1) * ((conv_cols - PK) / PS + 1);
+
+    data_t w_buf[C_OUT * KS * KS * C_IN];
+#pragma HLS ARRAY_PARTITION variable=w_buf complete
+    hls::stream<pixel_pkt<C_IN> > in_pix;
+    hls::stream<pixel_pkt<C_OUT> > conv_pix;
+    hls::stream<pixel_pkt<C_OUT> > pool_pix;
+#pragma HLS STREAM variable=in_pix depth=2
+#pragma HLS STREAM variable=conv_pix depth=2
+#pragma HLS STREAM variable=pool_pix depth=2
+
+    weight_load<C_OUT * KS * KS * C_IN>(weight, w_buf);
+    axis_unpack<H * W, C_IN, BUS_W>(in_stream, in_pix, frames, nrows * ncols);
+    conv_engine<H, W, C_IN, C_OUT, KS, 1>(in_pix, conv_pix, w_buf, bias,
+                                          qmul, qshift, act, act_param,
+                                          nrows, ncols, chans, 1);
+    pool_engine<CH, CW, C_OUT, PK, PS>(conv_pix, pool_pix, pool_mode,
+                                       conv_rows, conv_cols);
+    axis_pack<((CH - PK) / PS + 1) * ((CW - PK) / PS + 1), C_OUT, BUS_W>(
+        pool_pix, out_stream, out_pix_n);
+}
+
+/*
+ * ߴʱ, ʱһߴһƳ
+ * SETUP ΪʱȨƫõ, LATENCY Ϊлһ
+ * ֮ǰҪ. WEIGHTS ΪȨظ, WORDS Ϊ m_axi .
+ */
+template<int H_, int W_, int C_IN_, int C_OUT_, int KS_>
+struct conv_shape {
+    static const int H = H_;
+    static const int W = W_;
+    static const int C_IN = C_IN_;
+    static const int C_OUT = C_OUT_;
+    static const int KS = KS_;
+    static const int OH = H_ - KS_ + 1;
+    static const int OW = W_ - KS_ + 1;
+
+    static const int WEIGHTS = C_OUT_ * KS_ * KS_ * C_IN_;
+    static const int WORDS = (WEIGHTS * DATA_W + WBUS_W - 1) / WBUS_W;
+    static const int SETUP = WORDS + C_OUT_;
+    static const int LATENCY = (KS_ - 1) * W_ + KS_ - 1;
+};
+
+/*
+ *  FIFO 
+ * вͬʱ, һ SETUP + LATENCY ںʼ, һ
+ * SETUP ںʼȡ. ȸ֮, һ㲻֡ױѹ.
+ */
+template<class PREV, class NEXT>
+struct link_depth {
+    static const int SLACK = NEXT::SETUP - (PREV::SETUP + PREV::LATENCY);
+    static const int value = (SLACK > 0 ? SLACK : 0) + 2;
+};
+
+/*
+ * ν: ߴ FIFO 
+ * һߴһߴ, ʧ.
+ */
+template<class PREV, class NEXT>
+struct chain_link {
+    typedef char shape_check[(NEXT::H == PREV::OH && NEXT::W == PREV::OW &&
+                              NEXT::C_IN == PREV::C_OUT) ? 1 : -1];
+    static const int depth = link_depth<PREV, NEXT>::value;
+};
+
+/*
+ * еһ: Ȩ -> , Ƭ
+ * ߵ DATAFLOW , Ȩһ.
+ * 綼 conv_chain2 / conv_chain3 д: һ DATAFLOW
+ * ε axis_unpackÿһ conv_stageaxis_pack, 
+ * ֮ FIFO ȡ chain_link<PREV, NEXT>::depth.
+ * rows / cols / chans Ϊʱߴ.
+ */
+template<class L>
+void conv_stage(
+    hls::stream<pixel_pkt<L::C_IN> > &in_pix,
+    hls::stream<pixel_pkt<L::C_OUT> > &out_pix,
+    const wbus_t *w,
+    bias_t b[L::C_OUT],
+    qmul_t m[L::C_OUT],
+    qshift_t s[L::C_OUT],
+    act_t a,
+    ap_uint<8> p,
+    dim_t rows,
+    dim_t cols,
+    dim_t chans
+) {
+#pragma HLS INLINE
+    //ÿȨظƹһ, 㲢
+    data_t wb[L::WEIGHTS];
+#pragma HLS ARRAY_PARTITION variable=wb complete
+
+    weight_load<L::WEIGHTS>(w, wb);
+    conv_engine<L::H, L::W, L::C_IN, L::C_OUT, L::KS, 1>(
+        in_pix, out_pix, wb, b, m, s, a, p, rows, cols, chans, 1);
+}
+
+/*
+ * :  -> L1 -> L2 -> 
+ * мͼֻƬ FIFO,  DATAFLOW ¶̵вй.
+ * rows / cols / chans Ϊһߴ, ߴƳ.
+ * rows / cols  dim_clamp , һһ.
+ */
+template<class L1, class L2, int BUS_W>
+void conv_chain2(
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > &in_stream,
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > &out_stream,
+    const wbus_t *w1,
+    bias_t b1[L1::C_OUT],
+    qmul_t m1[L1::C_OUT],
+    qshift_t s1[L1::C_OUT],
+    act_t a1,
+    ap_uint<8> p1,
+    const wbus_t *w2,
+    bias_t b2[L2::C_OUT],
+    qmul_t m2[L2::C_OUT],
+    qshift_t s2[L2::C_OUT],
+    act_t a2,
+    ap_uint<8> p2,
+    ap_uint<32> frames,
+    dim_t rows,
+    dim_t cols,
+    dim_t chans
+) {
+#pragma HLS DATAFLOW
+    const int D12 = chain_link<L1, L2>::depth;
+    const int MIN_IN = L1::KS + L2::KS - 1;
+
+    dim_t nrows = dim_clamp(rows, MIN_IN, L1::H);
+    dim_t ncols = dim_clamp(cols, MIN_IN, L1::W);
+    dim_t rows2 = nrows - L1::KS + 1;
+    dim_t cols2 = ncols - L1::KS + 1;
+    ap_uint<32> out_pix_n = (rows2 - L2::KS + 1) * (cols2 - L2::KS + 1);
+
+    hls::stream<pixel_pkt<L1::C_IN> > in_pix;
+    hls::stream<pixel_pkt<L1::C_OUT> > pix12;
+    hls::stream<pixel_pkt<L2::C_OUT> > out_pix;
+#pragma HLS STREAM variable=in_pix depth=2
+#pragma HLS STREAM variable=pix12 depth=D12
+#pragma HLS STREAM variable=out_pix depth=2
+
+    axis_unpack<L1::H * L1::W, L1::C_IN, BUS_W>(in_stream, in_pix, frames,
+                                                nrows * ncols);
+    conv_stage<L1>(in_pix, pix12, w1, b1, m1, s1, a1, p1, nrows, ncols, chans);
+    conv_stage<L2>(pix12, out_pix, w2, b2, m2, s2, a2, p2, rows2, cols2,
+                   L2::C_IN);
+    axis_pack<L2::OH * L2::OW, L2::C_OUT, BUS_W>(out_pix, out_stream,
+                                                 out_pix_n);
+}
+
+/*
+ * :  -> L1 -> L2 -> L3 -> , ṹͬ conv_chain2
+ */
+template<class L1, class L2, class L3, int BUS_W>
+void conv_chain3(
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > &in_stream,
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > &out_stream,
+    const wbus_t *w1,
+    bias_t b1[L1::C_OUT],
+    qmul_t m1[L1::C_OUT],
+    qshift_t s1[L1::C_OUT],
+    act_t a1,
+    ap_uint<8> p1,
+    const wbus_t *w2,
+    bias_t b2[L2::C_OUT],
+    qmul_t m2[L2::C_OUT],
+    qshift_t s2[L2::C_OUT],
+    act_t a2,
+    ap_uint<8> p2,
+    const wbus_t *w3,
+    bias_t b3[L3::C_OUT],
+    qmul_t m3[L3::C_OUT],
+    qshift_t s3[L3::C_OUT],
+    act_t a3,
+    ap_uint<8> p3,
+    ap_uint<32> frames,
+    dim_t rows,
+    dim_t cols,
+    dim_t chans
+) {
+#pragma HLS DATAFLOW
+    const int D12 = chain_link<L1, L2>::depth;
+    const int D23 = chain_link<L2, L3>::depth;
+    const int MIN_IN = L1::KS + L2::KS + L3::KS - 2;
+
+    dim_t nrows = dim_clamp(rows, MIN_IN, L1::H);
+    dim_t ncols = dim_clamp(cols, MIN_IN, L1::W);
+    dim_t rows2 = nrows - L1::KS + 1;
+    dim_t cols2 = ncols - L1::KS + 1;
+    dim_t rows3 = rows2 - L2::KS + 1;
+    dim_t cols3 = cols2 - L2::KS + 1;
+    ap_uint<32> out_pix_n = (rows3 - L3::KS + 1) * (cols3 - L3::KS + 1);
+
+    hls::stream<pixel_pkt<L1::C_IN> > in_pix;
+    hls::stream<pixel_pkt<L1::C_OUT> > pix12;
+    hls::stream<pixel_pkt<L2::C_OUT> > pix23;
+    hls::stream<pixel_pkt<L3::C_OUT> > out_pix;
+#pragma HLS STREAM variable=in_pix depth=2
+#pragma HLS STREAM variable=pix12 depth=D12
+#pragma HLS STREAM variable=pix23 depth=D23
+#pragma HLS STREAM variable=out_pix depth=2
+
+    axis_unpack<L1::H * L1::W, L1::C_IN, BUS_W>(in_stream, in_pix, frames,
+                                                nrows * ncols);
+    conv_stage<L1>(in_pix, pix12, w1, b1, m1, s1, a1, p1, nrows, ncols, chans);
+    conv_stage<L2>(pix12, pix23, w2, b2, m2, s2, a2, p2, rows2, cols2,
+                   L2::C_IN);
+    conv_stage<L3>(pix23, out_pix, w3, b3, m3, s3, a3, p3, rows3, cols3,
+                   L3::C_IN);
+    axis_pack<L3::OH * L3::OW, L3::C_OUT, BUS_W>(out_pix, out_stream,
+                                                 out_pix_n);
+}
+
+void cnn_conv_layer(
+    hls::stream<axis_t> &in_stream,
+    hls::stream<axis_t> &out_stream,
+    const wbus_t *weight,
+    bias_t bias[OUT_C],
+    qmul_t qmul[OUT_C],
+    qshift_t qshift[OUT_C],
+    act_t act,
+    ap_uint<8> act_param,
+    ap_uint<32> frames,
+    dim_t rows,
+    dim_t cols,
+    dim_t chans,
+    stride_t stride,
+    dim_t pad
+#if CONV_PERF
+    , axis_perf &perf_in,
+    axis_perf &perf_out
+#endif
+);
+
+void cnn_conv_pool_layer(
+    hls::stream<axis_t> &in_stream,
+    hls::stream<axis_t> &out_stream,
+    const wbus_t *weight,
+    bias_t bias[OUT_C],
+    qmul_t qmul[OUT_C],
+    qshift_t qshift[OUT_C],
+    act_t act,
+    ap_uint<8> act_param,
+    pool_t pool_mode,
+    ap_uint<32> frames,
+    dim_t rows,
+    dim_t cols,
+    dim_t chans
+);
+
+void cnn_dwsep_layer(
+    hls::stream<axis_t> &in_stream,
+    hls::stream<axis_t> &out_stream,
+    const wbus_t *dw_weight,
+    bias_t dw_bias[IN_C],
+    qmul_t dw_qmul[IN_C],
+    qshift_t dw_qshift[IN_C],
+    act_t dw_act,
+    ap_uint<8> dw_param,
+    const wbus_t *pw_weight,
+    bias_t pw_bias[OUT_C],
+    qmul_t pw_qmul[OUT_C],
+    qshift_t pw_qshift[OUT_C],
+    act_t pw_act,
+    ap_uint<8> pw_param,
+    ap_uint<32> frames,
+    dim_t rows,
+    dim_t cols,
+    dim_t chans
+);
+
+typedef conv_shape<IN_H, IN_W, IN_C, NET_C1, NET_K1> net_l1;
+typedef conv_shape<net_l1::OH, net_l1::OW, NET_C1, NET_C2, NET_K2> net_l2;
+typedef conv_shape<net_l2::OH, net_l2::OW, NET_C2, NET_C3, NET_K3> net_l3;
+
+void cnn_net(
+    hls::stream<axis_t> &in_stream,
+    hls::stream<axis_t> &out_stream,
+    const wbus_t *w1,
+    bias_t b1[NET_C1],
+    qmul_t m1[NET_C1],
+    qshift_t s1[NET_C1],
+    act_t a1,
+    ap_uint<8> p1,
+    const wbus_t *w2,
+    bias_t b2[NET_C2],
+    qmul_t m2[NET_C2],
+    qshift_t s2[NET_C2],
+    act_t a2,
+    ap_uint<8> p2,
+    const wbus_t *w3,
+    bias_t b3[NET_C3],
+    qmul_t m3[NET_C3],
+    qshift_t s3[NET_C3],
+    act_t a3,
+    ap_uint<8> p3,
+    ap_uint<32> frames,
+    dim_t rows,
+    dim_t cols,
+    dim_t chans
+);
+
+void cnn_gemm_layer(
+    hls::stream<axis_t> &in_stream,
+    hls::stream<axis_t> &out_stream,
+    const wbus_t *weight,
+    bias_t bias[GEMM_N],
+    qmul_t qmul[GEMM_N],
+    qshift_t qshift[GEMM_N],
+    act_t act,
+    ap_uint<8> act_param,
+    ap_uint<32> m,
+    dim_t kd,
+    dim_t n
+);
+
+#endif
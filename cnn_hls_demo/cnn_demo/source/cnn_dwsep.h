@@ -0,0 +1,262 @@
+/*******************************************************************************
+MIT License
+
+Copyright (c) 2021 LEON-LINKS-room
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#ifndef __CNN_DWSEP_H__
+#define __CNN_DWSEP_H__
+
+#include "cnn_demo.h"
+
+/*
+ * ȿɷ: KS x KS ͨ + 1x1 
+ * ͨÿֻͨͬһͨ, ÿ KS*KS*C γ˷;
+ * ÿ C_IN*C_OUT γ˷. Ȩظʽ conv_engine ͬ,
+ * ͨΪ [c][ky][kx], Ϊ [co][c].
+ */
+
+/*
+ * ͨ
+ * л봰ڽṹ conv_engine ͬ, ͨͨ.
+ */
+template<int H, int W, int C, int KS>
+void dw_engine(
+    hls::stream<pixel_pkt<C> > &in_stream,
+    hls::stream<pixel_pkt<C> > &out_stream,
+    data_t weight[C * KS * KS],
+    bias_t bias[C],
+    qmul_t qmul[C],
+    qshift_t qshift[C],
+    act_t act,
+    ap_uint<8> act_param,
+    dim_t rows,
+    dim_t cols,
+    dim_t chans
+) {
+    const int MAX_PIX = H * W;
+
+    bias_t b_local[C];
+#pragma HLS ARRAY_PARTITION variable=b_local complete
+    qmul_t m_local[C];
+#pragma HLS ARRAY_PARTITION variable=m_local complete
+    qshift_t s_local[C];
+#pragma HLS ARRAY_PARTITION variable=s_local complete
+
+    for (int c = 0; c < C; c++) {
+#pragma HLS PIPELINE II=1
+        b_local[c] = bias[c];
+        m_local[c] = qmul[c];
+        s_local[c] = qshift[c];
+    }
+
+    const int LB_ROWS = (KS > 1) ? KS - 1 : 1;
+    static ap_uint<C * DATA_W> linebuf[LB_ROWS][W];
+#pragma HLS ARRAY_PARTITION variable=linebuf complete dim=1
+#pragma HLS RESOURCE variable=linebuf core=RAM_2P_BRAM
+#pragma HLS DEPENDENCE variable=linebuf inter false
+    static int top = 0;
+    static data_t window[KS][KS][C];
+#pragma HLS ARRAY_PARTITION variable=window complete dim=0
+
+    int x = 0;
+    int y = 0;
+    bool end = false;
+
+    while (!end) {
+#pragma HLS PIPELINE II=1
+#pragma HLS LOOP_TRIPCOUNT min=1 max=MAX_PIX
+
+        pixel_pkt<C> pixel = in_stream.read();
+        for (int c = 0; c < C; c++) {
+#pragma HLS UNROLL
+            if (c >= chans)
+                pixel.data.range(c * DATA_W + DATA_W - 1, c * DATA_W) = 0;
+        }
+
+        bool row_end = (x == cols - 1);
+        window_shift<W, C, KS>(pixel.data, x, row_end, linebuf, top, window);
+
+        if (y >= KS - 1 && x >= KS - 1) {
+            pixel_pkt<C> out;
+
+            for (int c = 0; c < C; c++) {
+#pragma HLS UNROLL
+                //int32 ƫüۼֵɴ 33 λ, ֱͬӷ ACC_W 
+                ap_int<33> sum = b_local[c];
+
+                for (int ky = 0; ky < KS; ky++) {
+                    for (int kx = 0; kx < KS; kx++) {
+                        sum += window[ky][kx][c] *
+                               weight[(c * KS + ky) * KS + kx];
+                    }
+                }
+
+                out.data.range(c * DATA_W + DATA_W - 1, c * DATA_W) =
+                    (ap_uint<DATA_W>)requant_w<33, DATA_W>(
+                        sum, m_local[c], s_local[c], act, act_param);
+            }
+
+            out.end = pixel.end;
+            out_stream.write(out);
+        }
+
+        end = pixel.end;
+        if (row_end) {
+            x = 0;
+            y = (y == rows - 1) ? 0 : y + 1;
+        }
+        else {
+            x++;
+        }
+    }
+}
+
+/*
+ *  (1x1), ͨж PAR
+ * ÿļ PAR ͨ, ÿ C_OUT/PAR , ˷ PAR*C_IN .
+ * PAR = C_OUT ʱÿһ. Ҫл, H x W ֻѭ.
+ */
+template<int H, int W, int C_IN, int C_OUT, int PAR>
+void pw_engine(
+    hls::stream<pixel_pkt<C_IN> > &in_stream,
+    hls::stream<pixel_pkt<C_OUT> > &out_stream,
+    data_t weight[C_OUT * C_IN],
+    bias_t bias[C_OUT],
+    qmul_t qmul[C_OUT],
+    qshift_t qshift[C_OUT],
+    act_t act,
+    ap_uint<8> act_param
+) {
+    typedef char par_check[(C_OUT % PAR == 0) ? 1 : -1];
+    const int GROUPS = C_OUT / PAR;
+    const int MAX_ITER = H * W * GROUPS;
+
+    bias_t b_local[C_OUT];
+#pragma HLS ARRAY_PARTITION variable=b_local complete
+    qmul_t m_local[C_OUT];
+#pragma HLS ARRAY_PARTITION variable=m_local complete
+    qshift_t s_local[C_OUT];
+#pragma HLS ARRAY_PARTITION variable=s_local complete
+
+    for (int co = 0; co < C_OUT; co++) {
+#pragma HLS PIPELINE II=1
+        b_local[co] = bias[co];
+        m_local[co] = qmul[co];
+        s_local[co] = qshift[co];
+    }
+
+    pixel_pkt<C_IN> pixel;
+    pixel_pkt<C_OUT> out;
+    int g = 0;
+    bool end = false;
+
+    while (!end) {
+#pragma HLS PIPELINE II=1
+#pragma HLS LOOP_TRIPCOUNT min=1 max=MAX_ITER
+
+        if (g == 0)
+            pixel = in_stream.read();
+
+        // g ͨ
+        for (int p = 0; p < PAR; p++) {
+#pragma HLS UNROLL
+            int co = g * PAR + p;
+            ap_int<33> sum = b_local[co];
+
+            for (int c = 0; c < C_IN; c++) {
+#pragma HLS UNROLL
+                data_t v = pixel.data.range(c * DATA_W + DATA_W - 1, c * DATA_W);
+                sum += v * weight[co * C_IN + c];
+            }
+
+            out.data.range(co * DATA_W + DATA_W - 1, co * DATA_W) =
+                (ap_uint<DATA_W>)requant_w<33, DATA_W>(
+                    sum, m_local[co], s_local[co], act, act_param);
+        }
+
+        if (g == GROUPS - 1) {
+            out.end = pixel.end;
+            out_stream.write(out);
+            end = pixel.end;
+            g = 0;
+        }
+        else {
+            g++;
+        }
+    }
+}
+
+/*
+ * AXI-Stream ӿڵȿɷ
+ *  -> ͨ ->  -> , мͼֻƬ FIFO.
+ * ߴ conv_axis ͬ (rows / cols ͬ), 㼶жΪ PAR.
+ */
+template<int H, int W, int C, int C_OUT, int KS, int PAR, int BUS_W>
+void dwsep_axis(
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > &in_stream,
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > &out_stream,
+    const wbus_t *dw_weight,
+    bias_t dw_bias[C],
+    qmul_t dw_qmul[C],
+    qshift_t dw_qshift[C],
+    act_t dw_act,
+    ap_uint<8> dw_param,
+    const wbus_t *pw_weight,
+    bias_t pw_bias[C_OUT],
+    qmul_t pw_qmul[C_OUT],
+    qshift_t pw_qshift[C_OUT],
+    act_t pw_act,
+    ap_uint<8> pw_param,
+    ap_uint<32> frames,
+    dim_t rows,
+    dim_t cols,
+    dim_t chans
+) {
+#pragma HLS DATAFLOW
+    const int OH = H - KS + 1;
+    const int OW = W - KS + 1;
+    dim_t nrows = dim_clamp(rows, KS, H);
+    dim_t ncols = dim_clamp(cols, KS, W);
+    ap_uint<32> out_pix_n = (nrows - KS + 1) * (ncols - KS + 1);
+
+    data_t dw_buf[C * KS * KS];
+    data_t pw_buf[C_OUT * C];
+#pragma HLS ARRAY_PARTITION variable=dw_buf complete
+#pragma HLS ARRAY_PARTITION variable=pw_buf complete
+    hls::stream<pixel_pkt<C> > in_pix;
+    hls::stream<pixel_pkt<C> > dw_pix;
+    hls::stream<pixel_pkt<C_OUT> > out_pix;
+#pragma HLS STREAM variable=in_pix depth=2
+#pragma HLS STREAM variable=dw_pix depth=2
+#pragma HLS STREAM variable=out_pix depth=2
+
+    weight_load<C * KS * KS>(dw_weight, dw_buf);
+    weight_load<C_OUT * C>(pw_weight, pw_buf);
+    axis_unpack<H * W, C, BUS_W>(in_stream, in_pix, frames, nrows * ncols);
+    dw_engine<H, W, C, KS>(in_pix, dw_pix, dw_buf, dw_bias, dw_qmul, dw_qshift,
+                           dw_act, dw_param, nrows, ncols, chans);
+    pw_engine<OH, OW, C, C_OUT, PAR>(dw_pix, out_pix, pw_buf, pw_bias, pw_qmul,
+                                     pw_qshift, pw_act, pw_param);
+    axis_pack<OH * OW, C_OUT, BUS_W>(out_pix, out_stream, out_pix_n);
+}
+
+#endif
@@ -0,0 +1,475 @@
+/*******************************************************************************
+MIT License
+
+Copyright (c) 2021 LEON-LINKS-room
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#ifndef __CNN_GEMM_H__
+#define __CNN_GEMM_H__
+
+#include "cnn_demo.h"
+
+/*
+ * פ GEMM, ȫӲ 1x1 
+ * C[m][n] = requant(sum_k A[m][k] * B[k][n] + bias[n]), int8 ,
+ * 32 λۼ. 1x1  A Ϊ m , B[k][n] ΪȨ [co][c] ת.
+ *
+ *  PR  x PC зֿ,  PR x PC  PE, PE(i,j) ֻۼӿе
+ * C[i][j]. ÿ A һ (PR ) ࡢB һ (PC ) Ϸ,
+ *  PE ֮ҡ´;  i  j еֱ i 
+ * j Ľ,  PE(i,j) ڵ k+i+j ͬʱõ A[i][k]  B[k][j].
+ * һҪ kd+PR+PC-2 . ʱۼתӰӼĴ, һ
+ * ǰ PR , ռ.
+ *
+ * ݸʽ:
+ * A  AXI-Stream , m , ÿ kd  int8, ÿ BUS_W/8 , ÿд
+ * µһĿʼ,  TLAST . C ʽͬ, ÿ n , һ TLAST.
+ * B  m_axi , ԤȰ [n ][k][j]  (j Ϊк, 
+ * һ鲻 PC ʱ 0), Ԫذ WBUS_W/8 ÿ. ÿ A п鰴
+ * ˳ضһ B, ֻͻȡ.
+ */
+
+/*
+ * A пת: ÿ PR д a_buf, a_buf[k] Ϊ k е PR Ԫ,
+ * һ k ˳. һ鲻 PR ʱ 0.
+ *  FIFO һ, һʱطһ (˫).
+ */
+template<int PR, int KMAX, int BUS_W>
+void gemm_a_load(
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > &in_stream,
+    hls::stream<ap_uint<PR * DATA_W> > &a_tiles,
+    ap_uint<32> m,
+    dim_t kd
+) {
+    const int LANES = BUS_W / DATA_W;
+    const int MAX_BEATS = PR * ((KMAX + LANES - 1) / LANES);
+
+    ap_uint<PR * DATA_W> a_buf[KMAX];
+#pragma HLS ARRAY_PARTITION variable=a_buf cyclic factor=LANES
+    ap_uint<32> m_tiles = (m + PR - 1) / PR;
+    dim_t beats = (kd + LANES - 1) / LANES;
+
+    for (ap_uint<32> mt = 0; mt < m_tiles; mt++) {
+        ap_uint<32> rows = (m - mt * PR < PR) ? (ap_uint<32>)(m - mt * PR)
+                                              : (ap_uint<32>)PR;
+        int r = 0;
+        int b = 0;
+        for (int i = 0; i < rows * beats; i++) {
+#pragma HLS PIPELINE II=1
+#pragma HLS LOOP_TRIPCOUNT min=1 max=MAX_BEATS
+            ap_axis<BUS_W, 0, 0, 0> beat = in_stream.read();
+            for (int l = 0; l < LANES; l++) {
+#pragma HLS UNROLL
+                int k = b * LANES + l;
+                if (k < kd)
+                    a_buf[k].range(r * DATA_W + DATA_W - 1, r * DATA_W) =
+                        beat.data.range(l * DATA_W + DATA_W - 1, l * DATA_W);
+            }
+            if (b == beats - 1) {
+                b = 0;
+                r++;
+            }
+            else {
+                b++;
+            }
+        }
+
+        for (int k = 0; k < kd; k++) {
+#pragma HLS PIPELINE II=1
+#pragma HLS LOOP_TRIPCOUNT min=1 max=KMAX
+            ap_uint<PR * DATA_W> v = a_buf[k];
+            for (int i = 0; i < PR; i++) {
+#pragma HLS UNROLL
+                if (i >= rows)
+                    v.range(i * DATA_W + DATA_W - 1, i * DATA_W) = 0;
+            }
+            a_tiles.write(v);
+        }
+    }
+}
+
+//A пط: һ n ʱת߱,  n Ƭط
+template<int PR, int KMAX>
+void gemm_a_feed(
+    hls::stream<ap_uint<PR * DATA_W> > &a_tiles,
+    hls::stream<ap_uint<PR * DATA_W> > &a_vec,
+    ap_uint<32> m_tiles,
+    dim_t kd,
+    dim_t nt
+) {
+    ap_uint<PR * DATA_W> a_tile[KMAX];
+    ap_uint<32> total = m_tiles * nt * kd;
+    int k = 0;
+    int j = 0;
+
+    for (ap_uint<32> i = 0; i < total; i++) {
+#pragma HLS PIPELINE II=1
+#pragma HLS LOOP_TRIPCOUNT min=1 max=KMAX
+        ap_uint<PR * DATA_W> v;
+        if (j == 0) {
+            v = a_tiles.read();
+            a_tile[k] = v;
+        }
+        else {
+            v = a_tile[k];
+        }
+        a_vec.write(v);
+
+        if (k == kd - 1) {
+            k = 0;
+            j = (j == nt - 1) ? 0 : j + 1;
+        }
+        else {
+            k++;
+        }
+    }
+}
+
+/*
+ * B ȡ: ÿ A п˳һ nt*kd  PC Ԫص.
+ * PC*8  WBUS_W ʱһֺ, һռ;
+ * Ҫ֮һһ, Աÿһ.
+ */
+template<int PC, int KMAX, int NMAX>
+void gemm_b_fetch(
+    const wbus_t *weight,
+    hls::stream<ap_uint<PC * DATA_W> > &b_vec,
+    ap_uint<32> m_tiles,
+    dim_t kd,
+    dim_t nt
+) {
+    const int LANES = WBUS_W / DATA_W;
+    const int VEC_W = PC * DATA_W;
+    const int MAX_VECS = KMAX * ((NMAX + PC - 1) / PC);
+    typedef char pc_check[(LANES % PC == 0 || PC % LANES == 0) ? 1 : -1];
+    ap_uint<32> vecs = nt * kd;
+
+    for (ap_uint<32> mt = 0; mt < m_tiles; mt++) {
+        if (PC <= LANES) {
+            const int VPW = LANES / PC;
+            wbus_t word = 0;
+            int w = 0;
+            int s = 0;
+
+            for (ap_uint<32> v = 0; v < vecs; v++) {
+#pragma HLS PIPELINE II=1
+#pragma HLS LOOP_TRIPCOUNT min=1 max=MAX_VECS
+                if (s == 0)
+                    word = weight[w++];
+                b_vec.write(word.range(s * VEC_W + VEC_W - 1, s * VEC_W));
+                s = (s == VPW - 1) ? 0 : s + 1;
+            }
+        }
+        else {
+            const int WPV = PC / LANES;
+            ap_uint<PC * DATA_W> vec;
+            int s = 0;
+
+            for (ap_uint<32> w = 0; w < vecs * WPV; w++) {
+#pragma HLS PIPELINE II=1
+#pragma HLS LOOP_TRIPCOUNT min=1 max=MAX_VECS*WPV
+                vec.range(s * WBUS_W + WBUS_W - 1, s * WBUS_W) = weight[w];
+                if (s == WPV - 1) {
+                    b_vec.write(vec);
+                    s = 0;
+                }
+                else {
+                    s++;
+                }
+            }
+        }
+    }
+}
+
+/*
+ * PR x PC 
+ * a_reg / b_reg Ϊ PE ֮ĴݼĴ, ±ӴС, ÿ PE 
+ * Ϸ PE һĵֵ. a_skew / b_skew Ϊ߽ϵӳ,  i 
+ * ȡ i ǰ.  t >= kd ʱ 0, Կʱֻʣ 0,
+ * һ鲻մݼĴ.
+ * ÿӰӼĴһ (PC ,  requant), Ӧ nb*PC+j.
+ */
+template<int PR, int PC, int KMAX, int NMAX>
+void gemm_array(
+    hls::stream<ap_uint<PR * DATA_W> > &a_vec,
+    hls::stream<ap_uint<PC * DATA_W> > &b_vec,
+    hls::stream<ap_uint<PC * DATA_W> > &c_vec,
+    bias_t bias[NMAX],
+    qmul_t qmul[NMAX],
+    qshift_t qshift[NMAX],
+    act_t act,
+    ap_uint<8> act_param,
+    ap_uint<32> m_tiles,
+    dim_t kd,
+    dim_t nt
+) {
+    const int NB = (NMAX + PC - 1) / PC;
+
+    bias_t b_local[NB * PC];
+#pragma HLS ARRAY_PARTITION variable=b_local cyclic factor=PC
+    qmul_t m_local[NB * PC];
+#pragma HLS ARRAY_PARTITION variable=m_local cyclic factor=PC
+    qshift_t s_local[NB * PC];
+#pragma HLS ARRAY_PARTITION variable=s_local cyclic factor=PC
+
+    for (int n = 0; n < NB * PC; n++) {
+#pragma HLS PIPELINE II=1
+        b_local[n] = (n < NMAX) ? bias[n] : bias_t(0);
+        m_local[n] = (n < NMAX) ? qmul[n] : qmul_t(0);
+        s_local[n] = (n < NMAX) ? qshift[n] : qshift_t(0);
+    }
+
+    acc_t acc[PR][PC];
+#pragma HLS ARRAY_PARTITION variable=acc complete dim=0
+    acc_t shadow[PR][PC];
+#pragma HLS ARRAY_PARTITION variable=shadow complete dim=0
+    data_t a_reg[PR][PC];
+#pragma HLS ARRAY_PARTITION variable=a_reg complete dim=0
+    data_t b_reg[PR][PC];
+#pragma HLS ARRAY_PARTITION variable=b_reg complete dim=0
+    ap_uint<PR * DATA_W> a_skew[PR];
+#pragma HLS ARRAY_PARTITION variable=a_skew complete
+    ap_uint<PC * DATA_W> b_skew[PC];
+#pragma HLS ARRAY_PARTITION variable=b_skew complete
+
+    for (int i = 0; i < PR; i++) {
+#pragma HLS UNROLL
+        a_skew[i] = 0;
+        for (int j = 0; j < PC; j++) {
+            acc[i][j] = 0;
+            a_reg[i][j] = 0;
+            b_reg[i][j] = 0;
+        }
+    }
+    for (int j = 0; j < PC; j++) {
+#pragma HLS UNROLL
+        b_skew[j] = 0;
+    }
+
+    const int T_MAX = NB * (KMAX + PR + PC - 2) + PR;
+    ap_uint<32> tiles = m_tiles * nt;
+    int t_end = kd + PR + PC - 2;
+    ap_uint<32> tile = 0;
+    int t = 0;
+    int nb = 0;
+    int drain = PR;         //ӰӼĴ
+    int drain_nb = 0;
+
+    while (tile < tiles || drain < PR) {
+#pragma HLS PIPELINE II=1
+#pragma HLS LOOP_TRIPCOUNT min=1 max=T_MAX
+        bool comp = (tile < tiles);
+
+        if (comp) {
+            ap_uint<PR * DATA_W> a_in = 0;
+            ap_uint<PC * DATA_W> b_in = 0;
+            if (t < kd) {
+                a_in = a_vec.read();
+                b_in = b_vec.read();
+            }
+
+            for (int i = PR - 1; i > 0; i--) {
+#pragma HLS UNROLL
+                a_skew[i] = a_skew[i - 1];
+            }
+            a_skew[0] = a_in;
+            for (int j = PC - 1; j > 0; j--) {
+#pragma HLS UNROLL
+                b_skew[j] = b_skew[j - 1];
+            }
+            b_skew[0] = b_in;
+
+            for (int i = PR - 1; i >= 0; i--) {
+#pragma HLS UNROLL
+                for (int j = PC - 1; j >= 0; j--) {
+#pragma HLS UNROLL
+                    data_t a = (j == 0) ? (data_t)a_skew[i].range(
+                                              i * DATA_W + DATA_W - 1, i * DATA_W)
+                                        : a_reg[i][j - 1];
+                    data_t b = (i == 0) ? (data_t)b_skew[j].range(
+                                              j * DATA_W + DATA_W - 1, j * DATA_W)
+                                        : b_reg[i - 1][j];
+                    acc[i][j] += a * b;
+                    a_reg[i][j] = a;
+                    b_reg[i][j] = b;
+                }
+            }
+        }
+
+        //ӰӼĴ
+        if (drain < PR) {
+            ap_uint<PC * DATA_W> row;
+            for (int j = 0; j < PC; j++) {
+#pragma HLS UNROLL
+                int n = drain_nb * PC + j;
+                //ۼֵ int32 ƫ֮Ϊ 33 λ, س acc_t
+                ap_int<33> sum = shadow[0][j] + b_local[n];
+                row.range(j * DATA_W + DATA_W - 1, j * DATA_W) =
+                    (ap_uint<DATA_W>)requant_w<33, DATA_W>(sum, m_local[n],
+                                                           s_local[n], act,
+                                                           act_param);
+            }
+            c_vec.write(row);
+            for (int i = 0; i < PR - 1; i++) {
+#pragma HLS UNROLL
+                for (int j = 0; j < PC; j++) {
+                    shadow[i][j] = shadow[i + 1][j];
+                }
+            }
+            drain++;
+        }
+
+        //: ۼתӰӼĴ, һ鿪ʼ
+        if (comp) {
+            if (t == t_end - 1) {
+                for (int i = 0; i < PR; i++) {
+#pragma HLS UNROLL
+                    for (int j = 0; j < PC; j++) {
+                        shadow[i][j] = acc[i][j];
+                        acc[i][j] = 0;
+                    }
+                }
+                drain = 0;
+                drain_nb = nb;
+                nb = (nb == nt - 1) ? 0 : nb + 1;
+                t = 0;
+                tile++;
+            }
+            else {
+                t++;
+            }
+        }
+    }
+}
+
+/*
+ * : һ A п nt , ÿ n  int8,
+ * ʽͬ A. ĩһĵĲ keep Ϊ 0.
+ */
+template<int PR, int PC, int NMAX, int BUS_W>
+void gemm_c_store(
+    hls::stream<ap_uint<PC * DATA_W> > &c_vec,
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > &out_stream,
+    ap_uint<32> m,
+    dim_t n
+) {
+    const int LANES = BUS_W / DATA_W;
+    const int NB = (NMAX + PC - 1) / PC;
+    const int MAX_BEATS = PR * ((NMAX + LANES - 1) / LANES);
+    const int CF = (LANES > PC) ? LANES / PC : 1;
+
+    //һĵԪؿ LANES/PC , ڶά˷
+    ap_uint<PC * DATA_W> c_buf[PR][NB];
+#pragma HLS ARRAY_PARTITION variable=c_buf complete dim=1
+#pragma HLS ARRAY_PARTITION variable=c_buf cyclic factor=CF dim=2
+    ap_uint<32> m_tiles = (m + PR - 1) / PR;
+    dim_t nt = (n + PC - 1) / PC;
+    dim_t beats = (n + LANES - 1) / LANES;
+
+    for (ap_uint<32> mt = 0; mt < m_tiles; mt++) {
+        ap_uint<32> rows = (m - mt * PR < PR) ? (ap_uint<32>)(m - mt * PR)
+                                              : (ap_uint<32>)PR;
+
+        for (int nb = 0; nb < nt; nb++) {
+            for (int i = 0; i < PR; i++) {
+#pragma HLS PIPELINE II=1
+                c_buf[i][nb] = c_vec.read();
+            }
+        }
+
+        //ÿȡ LANES Ԫ,  e  c_buf[r][e / PC] ĵ e % PC 
+        int r = 0;
+        int b = 0;
+        for (int i = 0; i < rows * beats; i++) {
+#pragma HLS PIPELINE II=1
+#pragma HLS LOOP_TRIPCOUNT min=1 max=MAX_BEATS
+            ap_axis<BUS_W, 0, 0, 0> beat;
+            beat.data = 0;
+            beat.keep = 0;
+            for (int l = 0; l < LANES; l++) {
+#pragma HLS UNROLL
+                int e = b * LANES + l;
+                if (e < n) {
+                    beat.data.range(l * DATA_W + DATA_W - 1, l * DATA_W) =
+                        c_buf[r][e / PC].range((e % PC) * DATA_W + DATA_W - 1,
+                                               (e % PC) * DATA_W);
+                    beat.keep[l] = 1;
+                }
+            }
+            beat.last = (mt == m_tiles - 1 && r == rows - 1 && b == beats - 1);
+            out_stream.write(beat);
+
+            if (b == beats - 1) {
+                b = 0;
+                r++;
+            }
+            else {
+                b++;
+            }
+        }
+    }
+}
+
+/*
+ * AXI-Stream ӿڵ GEMM : A ת -> ط ->  <- B ȡ,  -> 
+ * m  (), kd <= KMAX, n <= NMAX ɼĴ, kd / n  dim_clamp
+ *  [1, KMAX] / [1, NMAX]. A  B ֮
+ * FIFO һ, ȡһ뵱ǰļص.
+ */
+template<int PR, int PC, int KMAX, int NMAX, int BUS_W>
+void gemm_axis(
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > &in_stream,
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > &out_stream,
+    const wbus_t *weight,
+    bias_t bias[NMAX],
+    qmul_t qmul[NMAX],
+    qshift_t qshift[NMAX],
+    act_t act,
+    ap_uint<8> act_param,
+    ap_uint<32> m,
+    dim_t kd,
+    dim_t n
+) {
+#pragma HLS DATAFLOW
+    const int NB = (NMAX + PC - 1) / PC;
+    dim_t nkd = dim_clamp(kd, 1, KMAX);
+    dim_t nn = dim_clamp(n, 1, NMAX);
+    ap_uint<32> m_tiles = (m + PR - 1) / PR;
+    dim_t nt = (nn + PC - 1) / PC;
+
+    hls::stream<ap_uint<PR * DATA_W> > a_tiles;
+    hls::stream<ap_uint<PR * DATA_W> > a_vec;
+    hls::stream<ap_uint<PC * DATA_W> > b_vec;
+    hls::stream<ap_uint<PC * DATA_W> > c_vec;
+#pragma HLS STREAM variable=a_tiles depth=KMAX
+#pragma HLS STREAM variable=a_vec depth=2
+#pragma HLS STREAM variable=b_vec depth=KMAX
+#pragma HLS STREAM variable=c_vec depth=PR*NB
+
+    gemm_a_load<PR, KMAX, BUS_W>(in_stream, a_tiles, m, nkd);
+    gemm_a_feed<PR, KMAX>(a_tiles, a_vec, m_tiles, nkd, nt);
+    gemm_b_fetch<PC, KMAX, NMAX>(weight, b_vec, m_tiles, nkd, nt);
+    gemm_array<PR, PC, KMAX, NMAX>(a_vec, b_vec, c_vec, bias, qmul, qshift,
+                                   act, act_param, m_tiles, nkd, nt);
+    gemm_c_store<PR, PC, NMAX, BUS_W>(c_vec, out_stream, m, nn);
+}
+
+#endif
@@ -0,0 +1,425 @@
+/*******************************************************************************
+MIT License
+
+Copyright (c) 2021 LEON-LINKS-room
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#ifndef __CNN_WINOGRAD_H__
+#define __CNN_WINOGRAD_H__
+
+#include "cnn_demo.h"
+
+/*
+ * Winograd F(2x2,3x3) , ֻ 3x3 
+ * Y = A^T [ (G g G^T) .* (B^T d B) ] A, ÿ 4x4 õ 2x2 ,
+ * ÿ/ͨ 16 γ˷, ֱӷҪ 36 .
+ *
+ * G  1/2,  G' = 2G, U' = G' g G'^T = 4U, 任
+ * ĽǡΪ 4 ,  2 λõֱӷȫͬۼֵ.
+ * 任,  golden_conv ϽΪ 0 (λһ).
+ *
+ * λ:  int8, V Ϊ DATA_W+3 λ, U' Ϊ DATA_W+4 λ, M 
+ * 任 40 λ, .
+ */
+#define WINO_V_W (DATA_W + 3)
+#define WINO_U_W (DATA_W + 4)
+
+typedef ap_int<WINO_V_W> wino_v_t;
+typedef ap_int<WINO_U_W> wino_u_t;
+typedef ap_int<40> wino_acc_t;
+
+//任: V , ÿ 4 λ, ÿλ C ͨ
+template<int C>
+struct wino_half {
+    ap_uint<2 * 4 * C * WINO_V_W> data;
+    bool end;
+};
+
+//Ȩر任 U' = G' g G'^T, G' = [2 0 0; 1 1 1; 1 -1 1; 0 0 2]
+inline void wino_weight_transform(data_t g[3][3], wino_u_t u[4][4]) {
+    ap_int<DATA_W + 2> t[4][3];
+#pragma HLS ARRAY_PARTITION variable=t complete dim=0
+
+    for (int j = 0; j < 3; j++) {
+        t[0][j] = 2 * g[0][j];
+        t[1][j] = g[0][j] + g[1][j] + g[2][j];
+        t[2][j] = g[0][j] - g[1][j] + g[2][j];
+        t[3][j] = 2 * g[2][j];
+    }
+    for (int i = 0; i < 4; i++) {
+        u[i][0] = 2 * t[i][0];
+        u[i][1] = t[i][0] + t[i][1] + t[i][2];
+        u[i][2] = t[i][0] - t[i][1] + t[i][2];
+        u[i][3] = 2 * t[i][2];
+    }
+}
+
+//任 V = B^T d B, B^T = [1 0 -1 0; 0 1 1 0; 0 -1 1 0; 0 1 0 -1]
+inline void wino_input_transform(data_t d[4][4], wino_v_t v[4][4]) {
+    ap_int<DATA_W + 2> t[4][4];
+#pragma HLS ARRAY_PARTITION variable=t complete dim=0
+
+    for (int j = 0; j < 4; j++) {
+        t[0][j] = d[0][j] - d[2][j];
+        t[1][j] = d[1][j] + d[2][j];
+        t[2][j] = d[2][j] - d[1][j];
+        t[3][j] = d[1][j] - d[3][j];
+    }
+    for (int i = 0; i < 4; i++) {
+        v[i][0] = t[i][0] - t[i][2];
+        v[i][1] = t[i][1] + t[i][2];
+        v[i][2] = t[i][2] - t[i][1];
+        v[i][3] = t[i][1] - t[i][3];
+    }
+}
+
+//任 Y = A^T M A / 4, A^T = [1 1 1 0; 0 1 -1 -1]
+inline void wino_output_transform(wino_acc_t m[4][4], wino_acc_t y[2][2]) {
+    wino_acc_t t[2][4];
+#pragma HLS ARRAY_PARTITION variable=t complete dim=0
+
+    for (int j = 0; j < 4; j++) {
+        t[0][j] = m[0][j] + m[1][j] + m[2][j];
+        t[1][j] = m[1][j] - m[2][j] - m[3][j];
+    }
+    for (int i = 0; i < 2; i++) {
+        y[i][0] = (t[i][0] + t[i][1] + t[i][2]) >> 2;
+        y[i][1] = (t[i][1] - t[i][2] - t[i][3]) >> 2;
+    }
+}
+
+/*
+ * һ: л + 4x4  + 任
+ * ½С (y, x >= 3) ʱõһ, Ӧ
+ * (y-3, x-3)  2x2 . ÿд V  0~1 к 2~3 .
+ */
+template<int H, int W, int C_IN>
+void wino_tile(
+    hls::stream<pixel_pkt<C_IN> > &in_stream,
+    hls::stream<wino_half<C_IN> > &half_stream,
+    dim_t rows,
+    dim_t cols,
+    dim_t chans
+) {
+    const int MAX_PIX = H * W;
+
+    static ap_uint<C_IN * DATA_W> linebuf[3][W];
+#pragma HLS ARRAY_PARTITION variable=linebuf complete dim=1
+#pragma HLS RESOURCE variable=linebuf core=RAM_2P_BRAM
+#pragma HLS DEPENDENCE variable=linebuf inter false
+    static int top = 0;
+    static data_t window[4][4][C_IN];
+#pragma HLS ARRAY_PARTITION variable=window complete dim=0
+
+    wino_half<C_IN> second;
+    bool pending = false;
+    bool in_end = false;
+    bool done = false;
+    int x = 0;
+    int y = 0;
+
+    //һһ, ڶһд
+    while (!done) {
+#pragma HLS PIPELINE II=1
+#pragma HLS LOOP_TRIPCOUNT min=1 max=MAX_PIX
+
+        bool tile = false;
+        bool row_end = (x == cols - 1);
+        pixel_pkt<C_IN> pixel;
+        pixel.end = false;
+
+        if (!in_end) {
+            pixel = in_stream.read();
+            for (int c = 0; c < C_IN; c++) {
+#pragma HLS UNROLL
+                if (c >= chans)
+                    pixel.data.range(c * DATA_W + DATA_W - 1, c * DATA_W) = 0;
+            }
+            window_shift<W, C_IN, 4>(pixel.data, x, row_end, linebuf, top, window);
+            tile = (y >= 3 && (y & 1) && x >= 3 && (x & 1));
+        }
+
+        wino_half<C_IN> first;
+        first.end = false;
+        for (int c = 0; c < C_IN; c++) {
+#pragma HLS UNROLL
+            data_t d[4][4];
+            wino_v_t v[4][4];
+            for (int i = 0; i < 4; i++) {
+                for (int j = 0; j < 4; j++) {
+                    d[i][j] = window[i][j][c];
+                }
+            }
+            wino_input_transform(d, v);
+
+            for (int i = 0; i < 2; i++) {
+                for (int j = 0; j < 4; j++) {
+                    int lo = ((i * 4 + j) * C_IN + c) * WINO_V_W;
+                    first.data.range(lo + WINO_V_W - 1, lo) =
+                        (ap_uint<WINO_V_W>)v[i][j];
+                    if (tile)
+                        second.data.range(lo + WINO_V_W - 1, lo) =
+                            (ap_uint<WINO_V_W>)v[i + 2][j];
+                }
+            }
+        }
+
+        //ֻг, 鲻ͬд
+        if (pending) {
+            half_stream.write(second);
+            pending = false;
+            done = second.end;
+        }
+        else if (tile) {
+            half_stream.write(first);
+            second.end = pixel.end;
+            pending = true;
+        }
+
+        if (!in_end) {
+            in_end = pixel.end;
+            if (row_end) {
+                x = 0;
+                y = (y == rows - 1) ? 0 : y + 1;
+            }
+            else {
+                x++;
+            }
+        }
+    }
+}
+
+/*
+ * ڶ: Ԫس˼
+ * ÿĴ U'.*V һ, 4 һ, ˷Ϊ 4*C_IN*C_OUT,
+ * ֱӷΪ 9*C_IN*C_OUT. ֻв, ƽÿһ,
+ * ÿ 4 ܸ. Ϊ 2x2 , Ϊ Y00 Y01 Y10 Y11.
+ */
+template<int C_IN, int C_OUT>
+void wino_mac(
+    hls::stream<wino_half<C_IN> > &half_stream,
+    hls::stream<pixel_pkt<4 * C_OUT> > &tile_stream,
+    data_t weight[C_OUT * 9 * C_IN],
+    bias_t bias[C_OUT],
+    qmul_t qmul[C_OUT],
+    qshift_t qshift[C_OUT],
+    act_t act,
+    ap_uint<8> act_param
+) {
+    bias_t b_local[C_OUT];
+#pragma HLS ARRAY_PARTITION variable=b_local complete
+    qmul_t m_local[C_OUT];
+#pragma HLS ARRAY_PARTITION variable=m_local complete
+    qshift_t s_local[C_OUT];
+#pragma HLS ARRAY_PARTITION variable=s_local complete
+
+    for (int co = 0; co < C_OUT; co++) {
+#pragma HLS PIPELINE II=1
+        b_local[co] = bias[co];
+        m_local[co] = qmul[co];
+        s_local[co] = qshift[co];
+    }
+
+    //Ȩر任ֻʱһ
+    wino_u_t u[C_OUT][C_IN][4][4];
+#pragma HLS ARRAY_PARTITION variable=u complete dim=0
+
+    for (int co = 0; co < C_OUT; co++) {
+        for (int c = 0; c < C_IN; c++) {
+#pragma HLS PIPELINE II=1
+            data_t g[3][3];
+            for (int ky = 0; ky < 3; ky++) {
+                for (int kx = 0; kx < 3; kx++) {
+                    g[ky][kx] = weight[((co * 3 + ky) * 3 + kx) * C_IN + c];
+                }
+            }
+            wino_weight_transform(g, u[co][c]);
+        }
+    }
+
+    wino_half<C_IN> half;
+    wino_acc_t m[C_OUT][4][4];
+#pragma HLS ARRAY_PARTITION variable=m complete dim=0
+    int q = 0;
+    bool end = false;
+
+    while (!end) {
+#pragma HLS PIPELINE II=1
+
+        if ((q & 1) == 0)
+            half = half_stream.read();
+
+        //ĵ V , ȡ԰ĵ q&1 
+        wino_acc_t mrow[C_OUT][4];
+#pragma HLS ARRAY_PARTITION variable=mrow complete dim=0
+        for (int co = 0; co < C_OUT; co++) {
+#pragma HLS UNROLL
+            for (int j = 0; j < 4; j++) {
+                wino_acc_t sum = 0;
+                for (int c = 0; c < C_IN; c++) {
+                    int lo = (((q & 1) * 4 + j) * C_IN + c) * WINO_V_W;
+                    wino_v_t v = half.data.range(lo + WINO_V_W - 1, lo);
+                    sum += u[co][c][q][j] * v;
+                }
+                mrow[co][j] = sum;
+                m[co][q][j] = sum;
+            }
+        }
+
+        if (q == 3) {
+            pixel_pkt<4 * C_OUT> out;
+
+            for (int co = 0; co < C_OUT; co++) {
+#pragma HLS UNROLL
+                wino_acc_t mm[4][4];
+                wino_acc_t yy[2][2];
+                for (int i = 0; i < 4; i++) {
+                    for (int j = 0; j < 4; j++) {
+                        mm[i][j] = (i == 3) ? mrow[co][j] : m[co][i][j];
+                    }
+                }
+                wino_output_transform(mm, yy);
+
+                //int32 ƫüۼֵɴ 33 λ, ֱͬӷ ACC_W 
+                for (int p = 0; p < 4; p++) {
+                    ap_int<33> sum = b_local[co] + (ap_int<33>)yy[p / 2][p % 2];
+                    int lo = (p * C_OUT + co) * DATA_W;
+                    out.data.range(lo + DATA_W - 1, lo) =
+                        (ap_uint<DATA_W>)requant_w<33, DATA_W>(
+                            sum, m_local[co], s_local[co], act, act_param);
+                }
+            }
+
+            out.end = half.end;
+            tile_stream.write(out);
+            end = half.end;
+        }
+
+        q = (q == 3) ? 0 : q + 1;
+    }
+}
+
+/*
+ * : ָդ˳
+ * һп Y00/Y01 ֱӰ, Y10/Y11 л, п.
+ * ÿп 2*ow , еʱ൱.
+ */
+template<int H, int W, int C_OUT>
+void wino_reorder(
+    hls::stream<pixel_pkt<4 * C_OUT> > &tile_stream,
+    hls::stream<pixel_pkt<C_OUT> > &out_stream,
+    dim_t cols
+) {
+    const int MAX_PIX = H * W;
+    const int PIX_W = C_OUT * DATA_W;
+
+    ap_uint<PIX_W> rowbuf[W];
+#pragma HLS ARRAY_PARTITION variable=rowbuf cyclic factor=2
+
+    dim_t ow = cols - 2;
+    ap_uint<PIX_W> held;
+    bool tile_end = false;
+    int i = 0;
+    bool end = false;
+
+    while (!end) {
+#pragma HLS PIPELINE II=1
+#pragma HLS LOOP_TRIPCOUNT min=1 max=MAX_PIX
+
+        pixel_pkt<C_OUT> out;
+        out.end = false;
+
+        if (i < ow) {
+            if ((i & 1) == 0) {
+                pixel_pkt<4 * C_OUT> t = tile_stream.read();
+                out.data = t.data.range(PIX_W - 1, 0);
+                held = t.data.range(2 * PIX_W - 1, PIX_W);
+                rowbuf[i] = t.data.range(3 * PIX_W - 1, 2 * PIX_W);
+                rowbuf[i + 1] = t.data.range(4 * PIX_W - 1, 3 * PIX_W);
+                tile_end = t.end;
+            }
+            else {
+                out.data = held;
+            }
+        }
+        else {
+            out.data = rowbuf[i - ow];
+            out.end = tile_end && (i == 2 * ow - 1);
+        }
+
+        out_stream.write(out);
+        end = out.end;
+        i = (i == 2 * ow - 1) ? 0 : i + 1;
+    }
+}
+
+/*
+ * AXI-Stream ӿڵ Winograd , ӿ conv_axis<..., 3, BUS_W> ͬ
+ *  -> 任 -> ˼ ->  -> . ߴ (rows-2) x (cols-2)
+ * Ϊż,  rows / cols Ϊż. rows / cols  dim_clamp 
+ * [4, H] / [4, W], ټ 1.
+ */
+template<int H, int W, int C_IN, int C_OUT, int BUS_W>
+void winograd_axis(
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > &in_stream,
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > &out_stream,
+    const wbus_t *weight,
+    bias_t bias[C_OUT],
+    qmul_t qmul[C_OUT],
+    qshift_t qshift[C_OUT],
+    act_t act,
+    ap_uint<8> act_param,
+    ap_uint<32> frames,
+    dim_t rows,
+    dim_t cols,
+    dim_t chans
+) {
+#pragma HLS DATAFLOW
+    typedef char even_check[(H % 2 == 0 && W % 2 == 0) ? 1 : -1];
+
+    //мв, FIFO ԼеĿ
+    const int HALF_DEPTH = W / 2 + 2;
+    const int TILE_DEPTH = W / 4 + 2;
+    dim_t nrows = dim_clamp(rows, 4, H) & ~1;
+    dim_t ncols = dim_clamp(cols, 4, W) & ~1;
+    ap_uint<32> out_pix_n = (nrows - 2) * (ncols - 2);
+
+    data_t w_buf[C_OUT * 9 * C_IN];
+#pragma HLS ARRAY_PARTITION variable=w_buf complete
+    hls::stream<pixel_pkt<C_IN> > in_pix;
+    hls::stream<wino_half<C_IN> > halves;
+    hls::stream<pixel_pkt<4 * C_OUT> > tiles;
+    hls::stream<pixel_pkt<C_OUT> > out_pix;
+#pragma HLS STREAM variable=in_pix depth=2
+#pragma HLS STREAM variable=halves depth=HALF_DEPTH
+#pragma HLS STREAM variable=tiles depth=TILE_DEPTH
+#pragma HLS STREAM variable=out_pix depth=2
+
+    weight_load<C_OUT * 9 * C_IN>(weight, w_buf);
+    axis_unpack<H * W, C_IN, BUS_W>(in_stream, in_pix, frames, nrows * ncols);
+    wino_tile<H, W, C_IN>(in_pix, halves, nrows, ncols, chans);
+    wino_mac<C_IN, C_OUT>(halves, tiles, w_buf, bias, qmul, qshift,
+                          act, act_param);
+    wino_reorder<H, W, C_OUT>(tiles, out_pix, ncols);
+    axis_pack<(H - 2) * (W - 2), C_OUT, BUS_W>(out_pix, out_stream, out_pix_n);
+}
+
+#endif
@@ -0,0 +1,310 @@
+/*******************************************************************************
+MIT License
+
+Copyright (c) 2021 LEON-LINKS-room
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#ifndef __HOST_CONV_H__
+#define __HOST_CONV_H__
+
+/*
+ * 主机端 int8 参考卷积 (NHWC), 用于大尺寸验证和加速器忙时的 CPU 后备
+ * 输入 [y][x][c], 权重 [co][ky][kx][c], 输出 [y][x][co], 与 HLS 核格式相同.
+ * 一个输出像素的一行抽头 (kx, c) 在输入与权重中都是连续的 KS*C_IN 个字节,
+ * 按这一长度做点积, 由 SIMD 实现:
+ *   AVX2        符号扩展到 16 位, vpmaddwd, 每次 16 个
+ *   AVX-512     同上, 每次 32 个
+ *   AVX-512 VNNI vpdpbusd (u8 x s8), 输入加 128 转为无符号, 结果减去
+ *               128 * sum(w), 每次 64 个, 尾部用掩码载入
+ * 输出通道按块处理, 一块的权重留在 L1 中扫过整幅图.
+ * 累加与 requant 用 64 位整数, 与 HLS 核逐位一致 (KS*KS*C_IN < 2^17 时
+ * 点积不会溢出 32 位).
+ * 指令集在运行时检测, 不需要额外的编译选项.
+ */
+
+#include <stdint.h>
+#include <vector>
+#include "cnn_demo.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+#define HOST_CONV_AVX2 1
+#include <immintrin.h>
+#else
+#define HOST_CONV_AVX2 0
+#endif
+
+#if HOST_CONV_AVX2 && (defined(__clang__) || __GNUC__ >= 8)
+#define HOST_CONV_AVX512 1
+#else
+#define HOST_CONV_AVX512 0
+#endif
+
+enum host_isa {
+    HOST_SCALAR = 0,
+    HOST_AVX2,
+    HOST_AVX512,
+    HOST_AVX512_VNNI,
+    HOST_ISA_N
+};
+
+inline const char *host_isa_name(int isa) {
+    static const char *names[HOST_ISA_N] = {
+        "scalar", "avx2", "avx512", "avx512-vnni"
+    };
+    return names[isa];
+}
+
+//本机支持的最高指令集
+inline int host_detect_isa() {
+    int isa = HOST_SCALAR;
+#if HOST_CONV_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        isa = HOST_AVX2;
+#if HOST_CONV_AVX512
+    if (__builtin_cpu_supports("avx512bw"))
+        isa = HOST_AVX512;
+    if (isa == HOST_AVX512 && __builtin_cpu_supports("avx512vnni"))
+        isa = HOST_AVX512_VNNI;
+#endif
+#endif
+    return isa;
+}
+
+//卷积层描述, 量化参数含义同 requant
+struct host_conv_layer {
+    int h;
+    int w;
+    int c_in;
+    int c_out;
+    int ks;
+    const int8_t *weight;
+    const int32_t *bias;
+    const uint16_t *qmul;
+    const uint8_t *qshift;
+    int act;
+    int act_param;
+};
+
+//输出级, 舍入、激活与饱和同 requant
+inline int8_t host_requant(int64_t acc, int qmul, int qshift, int act,
+                           int act_param) {
+    int64_t v = acc * qmul;
+    if (qshift > 0)
+        v = (v + ((int64_t)1 << (qshift - 1))) >> qshift;
+
+    if (v < 0) {
+        if (act == ACT_RELU || act == ACT_RELU6)
+            v = 0;
+        else if (act == ACT_LEAKY)
+            v = (v * act_param + 128) >> 8;
+    }
+    if (act == ACT_RELU6 && v > act_param)
+        v = act_param;
+
+    if (v > 127)
+        v = 127;
+    if (v < -128)
+        v = -128;
+    return (int8_t)v;
+}
+
+//长度为 n 的 int8 点积, wsum 为 b 的元素和 (只有 VNNI 使用)
+typedef int32_t (*host_dot_fn)(const int8_t *a, const int8_t *b, int n,
+                               int32_t wsum);
+
+inline int32_t host_dot_scalar(const int8_t *a, const int8_t *b, int n,
+                               int32_t wsum) {
+    (void)wsum;
+    int32_t sum = 0;
+    for (int i = 0; i < n; i++)
+        sum += a[i] * b[i];
+    return sum;
+}
+
+#if HOST_CONV_AVX2
+__attribute__((target("avx2")))
+inline int32_t host_dot_avx2(const int8_t *a, const int8_t *b, int n,
+                             int32_t wsum) {
+    (void)wsum;
+    __m256i acc = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i va = _mm256_cvtepi8_epi16(
+            _mm_loadu_si128((const __m128i *)(a + i)));
+        __m256i vb = _mm256_cvtepi8_epi16(
+            _mm_loadu_si128((const __m128i *)(b + i)));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(va, vb));
+    }
+
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(acc),
+                              _mm256_extracti128_si256(acc, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4e));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xb1));
+    int32_t sum = _mm_cvtsi128_si32(s);
+
+    for (; i < n; i++)
+        sum += a[i] * b[i];
+    return sum;
+}
+#endif
+
+#if HOST_CONV_AVX512
+__attribute__((target("avx512f,avx512bw")))
+inline int32_t host_dot_avx512(const int8_t *a, const int8_t *b, int n,
+                               int32_t wsum) {
+    (void)wsum;
+    __m512i acc = _mm512_setzero_si512();
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m512i va = _mm512_cvtepi8_epi16(
+            _mm256_loadu_si256((const __m256i *)(a + i)));
+        __m512i vb = _mm512_cvtepi8_epi16(
+            _mm256_loadu_si256((const __m256i *)(b + i)));
+        acc = _mm512_add_epi32(acc, _mm512_madd_epi16(va, vb));
+    }
+
+    int32_t sum = _mm512_reduce_add_epi32(acc);
+    for (; i < n; i++)
+        sum += a[i] * b[i];
+    return sum;
+}
+
+//sum((a+128) * b) - 128 * sum(b); 掩码外的 b 为 0, a 的取值不影响结果
+__attribute__((target("avx512f,avx512bw,avx512vnni")))
+inline int32_t host_dot_vnni(const int8_t *a, const int8_t *b, int n,
+                             int32_t wsum) {
+    const __m512i bias = _mm512_set1_epi8((char)0x80);
+    __m512i acc = _mm512_setzero_si512();
+
+    for (int i = 0; i < n; i += 64) {
+        __mmask64 m = (n - i >= 64) ? ~(__mmask64)0
+                                    : (((__mmask64)1 << (n - i)) - 1);
+        __m512i va = _mm512_xor_si512(_mm512_maskz_loadu_epi8(m, a + i), bias);
+        __m512i vb = _mm512_maskz_loadu_epi8(m, b + i);
+        acc = _mm512_dpbusd_epi32(acc, va, vb);
+    }
+    return _mm512_reduce_add_epi32(acc) - 128 * wsum;
+}
+#endif
+
+//isa 对应的点积, 本机或编译器不支持时退回标量
+inline host_dot_fn host_dot_select(int isa) {
+    if (isa > host_detect_isa())
+        return host_dot_scalar;
+#if HOST_CONV_AVX512
+    if (isa == HOST_AVX512_VNNI)
+        return host_dot_vnni;
+    if (isa == HOST_AVX512)
+        return host_dot_avx512;
+#endif
+#if HOST_CONV_AVX2
+    if (isa >= HOST_AVX2)
+        return host_dot_avx2;
+#endif
+    return host_dot_scalar;
+}
+
+//每行抽头的权重和 [co][ky], 供 VNNI 点积修正偏移
+inline void host_conv_wsum(const host_conv_layer &l, std::vector<int32_t> &wsum) {
+    const int row = l.ks * l.c_in;
+
+    wsum.resize(l.c_out * l.ks);
+    for (int r = 0; r < l.c_out * l.ks; r++) {
+        int32_t s = 0;
+        for (int i = 0; i < row; i++)
+            s += l.weight[r * row + i];
+        wsum[r] = s;
+    }
+}
+
+/*
+ * 一帧中输出行 [y0, y1) 的卷积, 分块计算与多线程 (ref_runner.h) 共用
+ * fin / fout 为该帧的输入与输出, 输出行按完整帧的位置写入.
+ */
+inline void host_conv_rows(
+    const host_conv_layer &l,
+    const int32_t *wsum,
+    host_dot_fn dot,
+    const int8_t *fin,
+    int8_t *fout,
+    int y0,
+    int y1
+) {
+    const int ow = l.w - l.ks + 1;
+    const int row = l.ks * l.c_in;
+
+    //每个输出通道块的权重约 16 KB
+    int co_blk = (16 * 1024) / (l.ks * row);
+    if (co_blk < 1)
+        co_blk = 1;
+
+    for (int co0 = 0; co0 < l.c_out; co0 += co_blk) {
+        int co1 = (co0 + co_blk < l.c_out) ? co0 + co_blk : l.c_out;
+
+        for (int y = y0; y < y1; y++) {
+            for (int x = 0; x < ow; x++) {
+                const int8_t *patch = fin + (y * l.w + x) * l.c_in;
+                int8_t *px = fout + (y * ow + x) * l.c_out;
+
+                for (int co = co0; co < co1; co++) {
+                    int64_t acc = l.bias[co];
+                    for (int ky = 0; ky < l.ks; ky++) {
+                        int r = co * l.ks + ky;
+                        acc += dot(patch + ky * l.w * l.c_in,
+                                   l.weight + r * row, row, wsum[r]);
+                    }
+                    px[co] = host_requant(acc, l.qmul[co], l.qshift[co],
+                                          l.act, l.act_param);
+                }
+            }
+        }
+    }
+}
+
+/*
+ * frames 帧连续存放, 每帧输入 h*w*c_in, 输出 (h-ks+1)*(w-ks+1)*c_out 字节
+ * (valid, 步长 1). isa 取 host_detect_isa() 时使用本机最快的实现.
+ */
+inline void host_conv(
+    const host_conv_layer &l,
+    const int8_t *in,
+    int8_t *out,
+    int frames,
+    int isa
+) {
+    const int oh = l.h - l.ks + 1;
+    const int ow = l.w - l.ks + 1;
+    const int in_frame = l.h * l.w * l.c_in;
+    const int out_frame = oh * ow * l.c_out;
+
+    std::vector<int32_t> wsum;
+    host_conv_wsum(l, wsum);
+    host_dot_fn dot = host_dot_select(isa);
+
+    for (int f = 0; f < frames; f++) {
+        host_conv_rows(l, &wsum[0], dot, in + (int64_t)f * in_frame,
+                       out + (int64_t)f * out_frame, 0, oh);
+    }
+}
+
+#endif
@@ -0,0 +1,214 @@
+/*******************************************************************************
+MIT License
+
+Copyright (c) 2021 LEON-LINKS-room
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#ifndef __INFER_RUNTIME_H__
+#define __INFER_RUNTIME_H__
+
+/*
+ * 主机侧异步推理运行时
+ * 启动时分配一圈固定的帧缓冲 (相当于 DMA 预先登记的内存), 主机用
+ * acquire 取得空闲缓冲, 直接在其中准备输入, submit 后立即返回 future.
+ * 后台线程按提交顺序取出请求, 把使用同一组权重的连续请求合成一批
+ * (对应内核的 frames 寄存器), 交给后端处理. 后端可以是 C 仿真模型,
+ * 以后换成 AXI DMA. 主机准备第 N+1 帧时第 N 帧正在后端执行.
+ * 结果写回同一缓冲的 out, 使用完后 release 归还.
+ */
+
+#include <stdint.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <deque>
+#include <vector>
+
+//一个帧缓冲: 输入与输出区在运行时创建时一次分配
+struct frame_buffer {
+    int8_t *in;
+    int8_t *out;
+    int index;          //在缓冲圈中的序号
+    bool ok;            //后端处理是否成功
+    std::promise<frame_buffer *> done;
+};
+
+//后端: 连续处理 n 帧, 使用同一组权重 W, 结果写入各缓冲的 out
+template<class W>
+class infer_backend {
+public:
+    virtual ~infer_backend() {}
+    virtual bool run(frame_buffer *const *bufs, int n, const W &w) = 0;
+};
+
+template<class W>
+class infer_runtime {
+public:
+    /*
+     * buffers 个帧缓冲, 每个输入 in_bytes、输出 out_bytes 字节,
+     * 一次交给后端的帧数不超过 max_batch
+     */
+    infer_runtime(infer_backend<W> &backend, int buffers, size_t in_bytes,
+                  size_t out_bytes, int max_batch = 8)
+        : backend_(backend), max_batch_(max_batch), stop_(false),
+          inflight_(0), frames_(0), batches_(0) {
+        size_t stride = (in_bytes + out_bytes + 63) / 64 * 64;
+        mem_.resize(stride * buffers + 64);
+        //缓冲按 64 字节对齐, 便于 DMA 与向量化读写
+        int8_t *base = &mem_[0];
+        base += (64 - (uintptr_t)base % 64) % 64;
+
+        bufs_.resize(buffers);
+        for (int i = 0; i < buffers; i++) {
+            bufs_[i].in = base + stride * i;
+            bufs_[i].out = bufs_[i].in + in_bytes;
+            bufs_[i].index = i;
+            bufs_[i].ok = false;
+            free_.push_back(&bufs_[i]);
+        }
+        worker_ = std::thread(&infer_runtime::worker, this);
+    }
+
+    //已提交的请求全部处理完后退出
+    ~infer_runtime() {
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            stop_ = true;
+        }
+        work_cv_.notify_all();
+        worker_.join();
+    }
+
+    //取一个空闲缓冲, 全部在使用中时等待
+    frame_buffer *acquire() {
+        std::unique_lock<std::mutex> lk(m_);
+        while (free_.empty())
+            free_cv_.wait(lk);
+        frame_buffer *buf = free_.front();
+        free_.pop_front();
+        return buf;
+    }
+
+    //提交一帧, w 在 future 就绪之前须保持有效
+    std::future<frame_buffer *> submit(frame_buffer *buf, const W &w) {
+        buf->done = std::promise<frame_buffer *>();
+        std::future<frame_buffer *> f = buf->done.get_future();
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            queue_.push_back(request(buf, &w));
+            inflight_++;
+        }
+        work_cv_.notify_one();
+        return f;
+    }
+
+    //归还缓冲, 之后不能再访问其 in / out
+    void release(frame_buffer *buf) {
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            free_.push_back(buf);
+        }
+        free_cv_.notify_one();
+    }
+
+    //等待所有已提交的请求完成
+    void wait_idle() {
+        std::unique_lock<std::mutex> lk(m_);
+        while (inflight_ > 0)
+            idle_cv_.wait(lk);
+    }
+
+    //计数在锁内读取. 计数在 set_value 之后才更新, 取到最后一帧后须先
+    //wait_idle, 计数才包含最后一批
+    int buffers() const { return (int)bufs_.size(); }
+    long long frames() const {
+        std::lock_guard<std::mutex> lk(m_);
+        return frames_;
+    }
+    //后端调用次数, frames() / batches() 为平均批大小
+    long long batches() const {
+        std::lock_guard<std::mutex> lk(m_);
+        return batches_;
+    }
+
+private:
+    struct request {
+        frame_buffer *buf;
+        const W *w;
+        request(frame_buffer *b, const W *wp) : buf(b), w(wp) {}
+    };
+
+    void worker() {
+        std::vector<frame_buffer *> batch;
+        for (;;) {
+            const W *w;
+            batch.clear();
+            {
+                std::unique_lock<std::mutex> lk(m_);
+                while (!stop_ && queue_.empty())
+                    work_cv_.wait(lk);
+                if (queue_.empty())
+                    return;
+
+                //合并队首起使用同一组权重的连续请求
+                w = queue_.front().w;
+                while (!queue_.empty() && queue_.front().w == w &&
+                       (int)batch.size() < max_batch_) {
+                    batch.push_back(queue_.front().buf);
+                    queue_.pop_front();
+                }
+            }
+
+            bool ok = backend_.run(&batch[0], (int)batch.size(), *w);
+            for (size_t i = 0; i < batch.size(); i++) {
+                batch[i]->ok = ok;
+                batch[i]->done.set_value(batch[i]);
+            }
+
+            {
+                std::lock_guard<std::mutex> lk(m_);
+                inflight_ -= (int)batch.size();
+                frames_ += batch.size();
+                batches_++;
+            }
+            idle_cv_.notify_all();
+        }
+    }
+
+    infer_backend<W> &backend_;
+    int max_batch_;
+    std::vector<int8_t> mem_;
+    std::vector<frame_buffer> bufs_;
+    std::deque<frame_buffer *> free_;
+    std::deque<request> queue_;
+    std::thread worker_;
+    mutable std::mutex m_;
+    std::condition_variable work_cv_;
+    std::condition_variable free_cv_;
+    std::condition_variable idle_cv_;
+    bool stop_;
+    int inflight_;
+    long long frames_;
+    long long batches_;
+};
+
+#endif
@@ -0,0 +1,231 @@
+/*******************************************************************************
+MIT License
+
+Copyright (c) 2021 LEON-LINKS-room
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#ifndef __REF_RUNNER_H__
+#define __REF_RUNNER_H__
+
+/*
+ * 多线程参考模型, 用于大批量帧的验证
+ * 一批帧按 (帧, 输出行块) 拆成任务, 按输出顺序轮流分到各线程的队列.
+ * 线程从自己队列的头部取任务 (先做最早要比较的块), 队列空时从其他线程
+ * 队列的尾部窃取 (最晚才用到的块), 负载不均时自动平衡.
+ * 每块完成后置位, 比较方在 DUT 输出到达时调用 wait_tile 逐块等待并比较.
+ * 参考计算与 DUT 仿真重叠; C 仿真中 DUT 一次运行完才开始比较, 比较只与
+ * 尚未完成的参考块重叠.
+ * 本批的状态 (layer_ / in_ / out_ / wsum_ / dot_) 在任务入队前写好, 入队在
+ * 队列锁内进行, 线程取到任务时一定能看到对应批的状态.
+ */
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include "host_conv.h"
+
+class ref_runner {
+public:
+    //threads 为 0 时取本机硬件线程数
+    explicit ref_runner(int threads = 0) : stop_(false), gen_(0), steals_(0) {
+        tiles_ = 0;
+        remaining_ = 0;
+        if (threads <= 0)
+            threads = std::thread::hardware_concurrency();
+        if (threads <= 0)
+            threads = 1;
+        for (int i = 0; i < threads; i++)
+            queues_.push_back(std::unique_ptr<task_queue>(new task_queue));
+        for (int i = 0; i < threads; i++)
+            pool_.push_back(std::thread(&ref_runner::worker, this, i));
+    }
+
+    ~ref_runner() {
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            stop_ = true;
+        }
+        work_cv_.notify_all();
+        for (size_t i = 0; i < pool_.size(); i++)
+            pool_[i].join();
+    }
+
+    /*
+     * 启动一批: in 为 frames 帧连续的输入, 参考结果写入 out (格式同
+     * host_conv). 每块 tile_rows 个输出行. 返回时计算已在后台进行,
+     * in / out / l 引用的数组在 wait_all 之前须保持有效.
+     */
+    void start(const host_conv_layer &l, const int8_t *in, int8_t *out,
+               int frames, int tile_rows, int isa) {
+        wait_all();
+
+        layer_ = l;
+        in_ = in;
+        out_ = out;
+        oh_ = l.h - l.ks + 1;
+        tile_rows_ = tile_rows;
+        tiles_ = (oh_ + tile_rows - 1) / tile_rows;
+        dot_ = host_dot_select(isa);
+        host_conv_wsum(l, wsum_);
+
+        int n = frames * tiles_;
+        steals_ = 0;
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            done_.assign(n, 0);
+            remaining_ = n;
+        }
+        //上一批的线程可能仍在 take 中扫描队列, 入队须持有队列锁
+        for (int task = 0; task < n; task++) {
+            task_queue &tq = *queues_[task % queues_.size()];
+            std::lock_guard<std::mutex> lk(tq.m);
+            tq.q.push_back(task);
+        }
+
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            gen_++;
+        }
+        work_cv_.notify_all();
+    }
+
+    int threads() const { return (int)pool_.size(); }
+    int tiles_per_frame() const { return tiles_; }
+    int tile_rows() const { return tile_rows_; }
+    //本批的窃取次数
+    int steals() const { return steals_; }
+
+    //等待第 f 帧第 t 块参考结果完成
+    void wait_tile(int f, int t) {
+        std::unique_lock<std::mutex> lk(m_);
+        int task = f * tiles_ + t;
+        while (!done_[task])
+            done_cv_.wait(lk);
+    }
+
+    void wait_all() {
+        std::unique_lock<std::mutex> lk(m_);
+        while (remaining_ > 0)
+            done_cv_.wait(lk);
+    }
+
+private:
+    struct task_queue {
+        std::mutex m;
+        std::deque<int> q;
+    };
+
+    //先取自己队列头部, 再依次从其他队列尾部窃取
+    bool take(int id, int &task) {
+        int n = (int)queues_.size();
+        for (int k = 0; k < n; k++) {
+            task_queue &tq = *queues_[(id + k) % n];
+            std::lock_guard<std::mutex> lk(tq.m);
+            if (tq.q.empty())
+                continue;
+            if (k == 0) {
+                task = tq.q.front();
+                tq.q.pop_front();
+            }
+            else {
+                task = tq.q.back();
+                tq.q.pop_back();
+                steals_++;
+            }
+            return true;
+        }
+        return false;
+    }
+
+    void run(int task) {
+        int f = task / tiles_;
+        int y0 = (task % tiles_) * tile_rows_;
+        int y1 = (y0 + tile_rows_ < oh_) ? y0 + tile_rows_ : oh_;
+        int in_frame = layer_.h * layer_.w * layer_.c_in;
+        int out_frame = oh_ * (layer_.w - layer_.ks + 1) * layer_.c_out;
+
+        host_conv_rows(layer_, &wsum_[0], dot_, in_ + (int64_t)f * in_frame,
+                       out_ + (int64_t)f * out_frame, y0, y1);
+
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            done_[task] = 1;
+            remaining_--;
+        }
+        done_cv_.notify_all();
+    }
+
+    void worker(int id) {
+        unsigned seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lk(m_);
+                while (!stop_ && gen_ == seen)
+                    work_cv_.wait(lk);
+                if (stop_)
+                    return;
+                seen = gen_;
+            }
+
+            int task;
+            while (take(id, task))
+                run(task);
+        }
+    }
+
+    std::vector<std::thread> pool_;
+    std::vector<std::unique_ptr<task_queue> > queues_;
+    std::mutex m_;
+    std::condition_variable work_cv_;
+    std::condition_variable done_cv_;
+    bool stop_;
+    unsigned gen_;
+    std::atomic<int> steals_;
+
+    host_conv_layer layer_;
+    const int8_t *in_;
+    int8_t *out_;
+    int oh_;
+    int tile_rows_;
+    int tiles_;
+    host_dot_fn dot_;
+    std::vector<int32_t> wsum_;
+    std::vector<char> done_;
+    int remaining_;
+};
+
+//离开作用域时等待本批完成, 提前返回时参考线程不会再写已释放的输出
+class ref_batch_guard {
+public:
+    explicit ref_batch_guard(ref_runner &r) : r_(r) {}
+    ~ref_batch_guard() { r_.wait_all(); }
+
+private:
+    ref_batch_guard(const ref_batch_guard &);
+    ref_batch_guard &operator=(const ref_batch_guard &);
+    ref_runner &r_;
+};
+
+#endif
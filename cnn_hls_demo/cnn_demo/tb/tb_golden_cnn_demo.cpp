@@ -23,127 +23,2866 @@ SOFTWARE.
 *******************************************************************************/
 
 #include <iostream>
-#include <hls_stream.h>
-#include <ap_int.h>
-#include <ap_axi_sdata.h>
-
-//定义
-#define IN_H   14
-#define IN_W   14
-#define IN_C   3
-#define K      3
-#define OUT_H  (IN_H - K + 1)
-#define OUT_W  (IN_W - K + 1)
-
-typedef ap_int<8>  data_t;
-typedef ap_int<32> acc_t;
-typedef ap_axis<8, 0, 0, 0> axis_t;
-
-//DUT声明
-void cnn_conv_layer(
-    hls::stream<axis_t> &in_stream,
-    hls::stream<axis_t> &out_stream,
-    data_t weight[K][K][IN_C],
-    data_t bias
-);
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "cnn_demo.h"
+#include "cnn_winograd.h"
+#include "cnn_dwsep.h"
+#include "cnn_const.h"
+#include "cnn_gemm.h"
+#include "host_conv.h"
+#include "ref_runner.h"
+#include "tensor_io.h"
+#include "infer_runtime.h"
+
+#if defined(_WIN32)
+#include <process.h>
+#define tb_getpid _getpid
+#else
+#include <unistd.h>
+#define tb_getpid getpid
+#endif
+
+//输出级参考模型, 用 64 位整数独立实现 requant 的舍入、激活和饱和
+int golden_requant(long long acc, int qmul, int qshift, int act, int act_param,
+                   int out_w = DATA_W) {
+    long long v = acc * qmul;
+    if (qshift > 0)
+        v = (v + (1LL << (qshift - 1))) >> qshift;
+
+    if (act == ACT_RELU && v < 0)
+        v = 0;
+    if (act == ACT_RELU6)
+        v = (v < 0) ? 0 : (v > act_param ? act_param : v);
+    if (act == ACT_LEAKY && v < 0)
+        v = (v * act_param + 128) >> 8;
+
+    long long o_max = (1LL << (out_w - 1)) - 1;
+    if (v > o_max)
+        v = o_max;
+    if (v < -o_max - 1)
+        v = -o_max - 1;
+    return (int)v;
+}
+
+//墙钟时间, 毫秒
+double wall_ms() {
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+}
+
+//测试通过, 同时给出 DUT C 仿真耗时与每秒处理的输入像素数
+void report_pass(const char *name, double ms, long long pixels) {
+    std::cout << name << " passed (" << ms << " ms, "
+              << (long long)(pixels * 1000.0 / (ms > 0 ? ms : 1e-3))
+              << " pix/s)" << std::endl;
+}
+
+//Golden Reference用于对比, 64 位累加, 偏置取 int32 边界值时不回绕
+template<int H, int W, int C_IN, int C_OUT, int KS>
+void golden_conv(
+    data_t in[H][W][C_IN],
+    data_t out[H - KS + 1][W - KS + 1][C_OUT],
+    data_t weight[C_OUT][KS][KS][C_IN],
+    bias_t bias[C_OUT],
+    qmul_t qmul[C_OUT],
+    qshift_t qshift[C_OUT],
+    int act,
+    int act_param
+) {
+    for (int y = 0; y < H - KS + 1; y++) {
+        for (int x = 0; x < W - KS + 1; x++) {
+            for (int co = 0; co < C_OUT; co++) {
+                long long sum = bias[co].to_int64();
+                for (int ky = 0; ky < KS; ky++) {
+                    for (int kx = 0; kx < KS; kx++) {
+                        for (int c = 0; c < C_IN; c++) {
+                            sum += in[y + ky][x + kx][c].to_int64() *
+                                   weight[co][ky][kx][c].to_int64();
+                        }
+                    }
+                }
+                out[y][x][co] = golden_requant(sum, qmul[co], qshift[co],
+                                               act, act_param);
+            }
+        }
+    }
+}
+
+//逐通道卷积参考模型, weight[c][ky][kx], 64 位累加
+template<int H, int W, int C, int KS>
+void golden_dwconv(
+    data_t in[H][W][C],
+    data_t out[H - KS + 1][W - KS + 1][C],
+    data_t weight[C][KS][KS],
+    bias_t bias[C],
+    qmul_t qmul[C],
+    qshift_t qshift[C],
+    int act,
+    int act_param
+) {
+    for (int y = 0; y < H - KS + 1; y++) {
+        for (int x = 0; x < W - KS + 1; x++) {
+            for (int c = 0; c < C; c++) {
+                long long sum = bias[c].to_int64();
+                for (int ky = 0; ky < KS; ky++) {
+                    for (int kx = 0; kx < KS; kx++) {
+                        sum += in[y + ky][x + kx][c].to_int64() *
+                               weight[c][ky][kx].to_int64();
+                    }
+                }
+                out[y][x][c] = golden_requant(sum, qmul[c], qshift[c],
+                                              act, act_param);
+            }
+        }
+    }
+}
+
+//补零、步长与膨胀的卷积参考模型, 补零区域按 0 参与计算
+template<int H, int W, int C_IN, int C_OUT, int KS, int DIL, int S, int P>
+void golden_conv_ext(
+    data_t in[H][W][C_IN],
+    data_t out[(H + 2 * P - (KS - 1) * DIL - 1) / S + 1]
+              [(W + 2 * P - (KS - 1) * DIL - 1) / S + 1][C_OUT],
+    data_t weight[C_OUT][KS][KS][C_IN],
+    bias_t bias[C_OUT],
+    qmul_t qmul[C_OUT],
+    qshift_t qshift[C_OUT],
+    int act,
+    int act_param
+) {
+    const int OH = (H + 2 * P - (KS - 1) * DIL - 1) / S + 1;
+    const int OW = (W + 2 * P - (KS - 1) * DIL - 1) / S + 1;
+
+    for (int y = 0; y < OH; y++) {
+        for (int x = 0; x < OW; x++) {
+            for (int co = 0; co < C_OUT; co++) {
+                long long sum = bias[co].to_int64();
+                for (int ky = 0; ky < KS; ky++) {
+                    for (int kx = 0; kx < KS; kx++) {
+                        int iy = y * S + ky * DIL - P;
+                        int ix = x * S + kx * DIL - P;
+                        if (iy < 0 || iy >= H || ix < 0 || ix >= W)
+                            continue;
+                        for (int c = 0; c < C_IN; c++) {
+                            sum += in[iy][ix][c].to_int64() *
+                                   weight[co][ky][kx][c].to_int64();
+                        }
+                    }
+                }
+                out[y][x][co] = golden_requant(sum, qmul[co], qshift[co],
+                                               act, act_param);
+            }
+        }
+    }
+}
+
+//GEMM 参考模型: a 为 m x kd, w 为 n x kd (同逐点卷积权重 [co][c]), 64 位累加
+void golden_gemm(
+    const int8_t *a,
+    const int8_t *w,
+    const int32_t *bias,
+    const uint16_t *qmul,
+    const uint8_t *qshift,
+    int act,
+    int act_param,
+    int m,
+    int kd,
+    int n,
+    int8_t *out
+) {
+    for (int r = 0; r < m; r++) {
+        for (int c = 0; c < n; c++) {
+            long long sum = bias[c];
+            for (int k = 0; k < kd; k++)
+                sum += a[r * kd + k] * w[c * kd + k];
+            out[r * n + c] = golden_requant(sum, qmul[c], qshift[c], act,
+                                            act_param);
+        }
+    }
+}
+
+//池化参考模型
+template<int H, int W, int C, int PK, int PS>
+void golden_pool(
+    data_t in[H][W][C],
+    data_t out[(H - PK) / PS + 1][(W - PK) / PS + 1][C],
+    int mode
+) {
+    for (int y = 0; y < (H - PK) / PS + 1; y++) {
+        for (int x = 0; x < (W - PK) / PS + 1; x++) {
+            for (int c = 0; c < C; c++) {
+                int max_val = -128;
+                int sum = 0;
+                for (int ky = 0; ky < PK; ky++) {
+                    for (int kx = 0; kx < PK; kx++) {
+                        int v = in[y * PS + ky][x * PS + kx][c];
+                        if (v > max_val)
+                            max_val = v;
+                        sum += v;
+                    }
+                }
+                if (mode == POOL_MAX)
+                    out[y][x][c] = max_val;
+                else
+                    out[y][x][c] = (int)std::floor((double)sum / (PK * PK) + 0.5);
+            }
+        }
+    }
+}
+
+/*
+ * 打包/拆包, 与 axis_unpack / axis_pack 的拍格式一致:
+ * 每拍字节数不少于通道数时一拍放 (BUS_W/8)/C 个像素, 否则一个像素占多拍,
+ * 填充字节为 0 且 keep 为 0, 每帧最后一拍置 TLAST (批处理按 TLAST
+ * 结束时只有最后一帧置位).
+ */
+template<int BUS_W, int H, int W, int C, int EW>
+void pack_frame(
+    ap_int<EW> in[H][W][C],
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > &s,
+    bool last = true
+) {
+    const int LANES = BUS_W / EW;
+    const int EB = EW / 8;
+    const int PPB = (LANES >= C) ? LANES / C : 1;
+    const int BPP = (LANES >= C) ? 1 : (C + LANES - 1) / LANES;
+    const int N = H * W;
+    const int BEATS = (LANES >= C) ? (N + PPB - 1) / PPB : N * BPP;
+
+    for (int b = 0; b < BEATS; b++) {
+        ap_axis<BUS_W, 0, 0, 0> beat;
+        beat.data = 0;
+        beat.keep = 0;
+        for (int l = 0; l < LANES; l++) {
+            int p, c;
+            if (LANES >= C) {
+                p = b * PPB + l / C;
+                c = l % C;
+                if (l >= PPB * C || p >= N)
+                    continue;
+            }
+            else {
+                p = b / BPP;
+                c = (b % BPP) * LANES + l;
+                if (c >= C)
+                    continue;
+            }
+            beat.data.range(l * EW + EW - 1, l * EW) =
+                (ap_uint<EW>)in[p / W][p % W][c];
+            beat.keep.range(l * EB + EB - 1, l * EB) = -1;
+        }
+        beat.last = last && (b == BEATS - 1);
+        s.write(beat);
+    }
+}
+
+template<int BUS_W, int H, int W, int C, int EW>
+bool unpack_frame(
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > &s,
+    ap_int<EW> out[H][W][C]
+) {
+    const int LANES = BUS_W / EW;
+    const int EB = EW / 8;
+    const int PPB = (LANES >= C) ? LANES / C : 1;
+    const int BPP = (LANES >= C) ? 1 : (C + LANES - 1) / LANES;
+    const int N = H * W;
+    const int BEATS = (LANES >= C) ? (N + PPB - 1) / PPB : N * BPP;
+
+    for (int b = 0; b < BEATS; b++) {
+        ap_axis<BUS_W, 0, 0, 0> beat = s.read();
+        if (beat.last != (b == BEATS - 1)) {
+            std::cout << "TLAST error @beat " << b << std::endl;
+            return false;
+        }
+        for (int l = 0; l < LANES; l++) {
+            int p, c;
+            if (LANES >= C) {
+                p = b * PPB + l / C;
+                c = l % C;
+                if (l >= PPB * C || p >= N)
+                    continue;
+            }
+            else {
+                p = b / BPP;
+                c = (b % BPP) * LANES + l;
+                if (c >= C)
+                    continue;
+            }
+            if (beat.keep.range(l * EB + EB - 1, l * EB) != (1 << EB) - 1) {
+                std::cout << "TKEEP error @beat " << b << std::endl;
+                return false;
+            }
+            out[p / W][p % W][c] =
+                (ap_int<EW>)beat.data.range(l * EW + EW - 1, l * EW);
+        }
+    }
+    return true;
+}
+
+/*
+ * 逐像素写入输入流, 格式同 pack_frame, 每帧 n 个像素
+ * 用于运行时尺寸的测试, 帧大小不必是编译时常数.
+ */
+template<int BUS_W, int C>
+struct axis_pixel_writer {
+    static const int LANES = BUS_W / DATA_W;
+    static const int PPB = (LANES >= C) ? LANES / C : 1;
+    static const int BPP = (LANES >= C) ? 1 : (C + LANES - 1) / LANES;
+
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > &s;
+    int n;
+    int i;
+    int lane;
+    ap_axis<BUS_W, 0, 0, 0> beat;
+
+    axis_pixel_writer(hls::stream<ap_axis<BUS_W, 0, 0, 0> > &stream, int pix_n)
+        : s(stream), n(pix_n), i(0), lane(0) {
+        beat.data = 0;
+        beat.keep = 0;
+    }
+
+    //写一个像素, last 为假时帧尾不置 TLAST (批处理按 TLAST 结束)
+    void write(const int8_t pix[C], bool last = true) {
+        bool frame_end = (i == n - 1);
+
+        if (BPP == 1) {
+            for (int c = 0; c < C; c++) {
+                int l = lane * C + c;
+                beat.data.range(l * DATA_W + DATA_W - 1, l * DATA_W) =
+                    (ap_uint<DATA_W>)pix[c];
+                beat.keep[l] = 1;
+            }
+            if (lane == PPB - 1 || frame_end) {
+                beat.last = last && frame_end;
+                s.write(beat);
+                beat.data = 0;
+                beat.keep = 0;
+                lane = 0;
+            }
+            else {
+                lane++;
+            }
+        }
+        else {
+            for (int b = 0; b < BPP; b++) {
+                beat.data = 0;
+                beat.keep = 0;
+                for (int l = 0; l < LANES && b * LANES + l < C; l++) {
+                    beat.data.range(l * DATA_W + DATA_W - 1, l * DATA_W) =
+                        (ap_uint<DATA_W>)pix[b * LANES + l];
+                    beat.keep[l] = 1;
+                }
+                beat.last = last && frame_end && b == BPP - 1;
+                s.write(beat);
+            }
+        }
+        i = frame_end ? 0 : i + 1;
+    }
+};
+
+/*
+ * 逐像素读取输出流, 格式同 unpack_frame, 每帧 n 个像素
+ * 用于输出到达时逐块比较, 不必先收完整帧.
+ */
+template<int BUS_W, int C>
+struct axis_pixel_reader {
+    static const int LANES = BUS_W / DATA_W;
+    static const int PPB = (LANES >= C) ? LANES / C : 1;
+    static const int BPP = (LANES >= C) ? 1 : (C + LANES - 1) / LANES;
+
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > &s;
+    int n;
+    int i;
+    int lane;
+    ap_axis<BUS_W, 0, 0, 0> beat;
+
+    axis_pixel_reader(hls::stream<ap_axis<BUS_W, 0, 0, 0> > &stream, int pix_n)
+        : s(stream), n(pix_n), i(0), lane(0) {}
+
+    //读一个像素, 检查 TLAST 只在每帧最后一拍出现
+    bool read(int8_t pix[C]) {
+        bool frame_end = (i == n - 1);
+        bool ok = true;
+
+        if (BPP == 1) {
+            if (lane == 0)
+                beat = s.read();
+            for (int c = 0; c < C; c++) {
+                int l = lane * C + c;
+                pix[c] = (int8_t)beat.data.range(l * DATA_W + DATA_W - 1,
+                                                 l * DATA_W).to_int();
+            }
+            if (lane == PPB - 1 || frame_end) {
+                ok = ((bool)beat.last == frame_end);
+                lane = 0;
+            }
+            else {
+                lane++;
+            }
+        }
+        else {
+            for (int b = 0; b < BPP; b++) {
+                beat = s.read();
+                ok = ok && ((bool)beat.last == (frame_end && b == BPP - 1));
+                for (int l = 0; l < LANES && b * LANES + l < C; l++) {
+                    pix[b * LANES + l] = (int8_t)beat.data.range(
+                        l * DATA_W + DATA_W - 1, l * DATA_W).to_int();
+                }
+            }
+        }
+
+        if (!ok)
+            std::cout << "TLAST error @pixel " << i << std::endl;
+        i = frame_end ? 0 : i + 1;
+        return ok;
+    }
+};
+
+//N 个权重按存储顺序打包为 m_axi 字, 与 weight_load 对应
+template<int N, int EW>
+void pack_weights(const ap_int<EW> *flat, wbus_t *dst) {
+    const int LANES = WBUS_W / EW;
+
+    for (int i = 0; i < (N + LANES - 1) / LANES; i++) {
+        dst[i] = 0;
+        for (int l = 0; l < LANES && i * LANES + l < N; l++) {
+            dst[i].range(l * EW + EW - 1, l * EW) =
+                (ap_uint<EW>)flat[i * LANES + l];
+        }
+    }
+}
+
+/*
+ * 列分块 (主机端): 图像宽于行缓冲时按竖条送入
+ * 每条输入宽 tile_w, 相邻条重叠 KS-1 列, 各条输出宽 tile_w-KS+1, 按条的
+ * 起始列写回. 最后一条右对齐到图像边缘, 与前一条重叠部分的输出相同.
+ * 所有条宽度相同, 一次调用按批处理全部条 (frames = tiles, cols = tile_w).
+ */
+struct tile_plan {
+    int tile_w;
+    int step;
+    int tiles;
+    int last_start;
+
+    tile_plan(int img_w, int tw, int ks) {
+        tile_w = tw;
+        step = tw - ks + 1;
+        tiles = (img_w - ks + 1 + step - 1) / step;
+        last_start = img_w - tw;
+    }
+
+    int start(int t) const {
+        return (t * step < last_start) ? t * step : last_start;
+    }
+};
+
+template<int BUS_W, int H, int IMG_W, int TILE_W, int C>
+void split_tiles(
+    data_t img[H][IMG_W][C],
+    const tile_plan &plan,
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > &s
+) {
+    typedef char width_check[(TILE_W <= IMG_W) ? 1 : -1];
+    static data_t strip[H][TILE_W][C];
+
+    for (int t = 0; t < plan.tiles; t++) {
+        int x0 = plan.start(t);
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < TILE_W; x++) {
+                for (int c = 0; c < C; c++) {
+                    strip[y][x][c] = img[y][x0 + x][c];
+                }
+            }
+        }
+        pack_frame<BUS_W, H, TILE_W, C>(strip, s);
+    }
+}
+
+template<int BUS_W, int OH, int OW, int TILE_OW, int C>
+bool stitch_tiles(
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > &s,
+    const tile_plan &plan,
+    data_t out[OH][OW][C]
+) {
+    static data_t strip[OH][TILE_OW][C];
+
+    for (int t = 0; t < plan.tiles; t++) {
+        if (!unpack_frame<BUS_W, OH, TILE_OW, C>(s, strip))
+            return false;
+        int x0 = plan.start(t);
+        for (int y = 0; y < OH; y++) {
+            for (int x = 0; x < TILE_OW; x++) {
+                for (int c = 0; c < C; c++) {
+                    out[y][x0 + x][c] = strip[y][x][c];
+                }
+            }
+        }
+    }
+    return true;
+}
+
+//一组卷积测试数据
+template<int H, int W, int C_IN, int C_OUT, int KS>
+struct conv_case {
+    static const int WORDS =
+        (C_OUT * KS * KS * C_IN * DATA_W + WBUS_W - 1) / WBUS_W;
+
+    data_t input[H][W][C_IN];
+    data_t weight[C_OUT][KS][KS][C_IN];
+    wbus_t wbus[WORDS];
+    bias_t bias[C_OUT];
+    qmul_t qmul[C_OUT];
+    qshift_t qshift[C_OUT];
+    int act;
+    int act_param;
+    int chans;
+
+    //chans 之后的输入通道仍填入数据, DUT 应按 0 处理
+    void init(int act_mode, int param, int frame = 0, int n_chans = C_IN,
+              int wseed = 0) {
+        act = act_mode;
+        act_param = param;
+        chans = n_chans;
+
+        //初始化输入
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                for (int c = 0; c < C_IN; c++) {
+                    input[y][x][c] = y + x + c + 5 * frame;
+                }
+            }
+        }
+
+        //初始化权重, 非对称取值以检查窗口方向
+        //缩放系数按通道不同, 使部分输出饱和
+        for (int co = 0; co < C_OUT; co++) {
+            bias[co] = 37 * co - 50;
+            qmul[co] = 3000 + 1500 * co;
+            qshift[co] = 12 - co % 3;
+            for (int ky = 0; ky < KS; ky++) {
+                for (int kx = 0; kx < KS; kx++) {
+                    for (int c = 0; c < C_IN; c++) {
+                        weight[co][ky][kx][c] =
+                            (co + 2 * ky + 3 * kx + c + wseed) % 5 - 2;
+                    }
+                }
+            }
+        }
+        pack_weights<C_OUT * KS * KS * C_IN>(&weight[0][0][0][0], wbus);
+
+#if CONV_CONST_WEIGHTS
+        //顶层权重固定, 与顶层同形状的测试改用滤波器组
+        if (C_IN == conv_bank::C_IN && C_OUT == conv_bank::C_OUT &&
+            KS == conv_bank::KS)
+            use_bank<conv_bank>();
+#endif
+    }
+
+    //换成滤波器组 F 的常数权重, F 的形状须与本组相同
+    template<class F>
+    void use_bank() {
+        for (int co = 0; co < C_OUT; co++) {
+            for (int ky = 0; ky < KS; ky++) {
+                for (int kx = 0; kx < KS; kx++) {
+                    for (int c = 0; c < C_IN; c++) {
+                        weight[co][ky][kx][c] = F::w(co, ky, kx, c);
+                    }
+                }
+            }
+        }
+        pack_weights<C_OUT * KS * KS * C_IN>(&weight[0][0][0][0], wbus);
+    }
+
+    void golden(data_t out[H - KS + 1][W - KS + 1][C_OUT]) {
+        static data_t masked[H][W][C_IN];
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                for (int c = 0; c < C_IN; c++) {
+                    masked[y][x][c] = (c < chans) ? input[y][x][c] : data_t(0);
+                }
+            }
+        }
+        golden_conv<H, W, C_IN, C_OUT, KS>(masked, out, weight, bias,
+                                           qmul, qshift, act, act_param);
+    }
+};
+
+//比较DUT与golden
+template<int H, int W, int C, int EW>
+bool compare_maps(
+    const char *name,
+    ap_int<EW> dut_out[H][W][C],
+    ap_int<EW> golden_out[H][W][C]
+) {
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            for (int c = 0; c < C; c++) {
+                if (dut_out[y][x][c] != golden_out[y][x][c]) {
+                    std::cout << name << " Mismatch @("
+                              << y << "," << x << "," << c << ") "
+                              << "DUT=" << dut_out[y][x][c]
+                              << " Golden=" << golden_out[y][x][c]
+                              << std::endl;
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+//单个尺寸的卷积测试: 生成数据, 运行golden和DUT并比较
+template<int H, int W, int C_IN, int C_OUT, int KS, int BUS_W>
+bool run_case(
+    const char *name,
+    void (*dut)(hls::stream<ap_axis<BUS_W, 0, 0, 0> > &,
+                hls::stream<ap_axis<BUS_W, 0, 0, 0> > &,
+                const wbus_t *, bias_t [C_OUT],
+                qmul_t [C_OUT], qshift_t [C_OUT], act_t, ap_uint<8>,
+                ap_uint<32>, dim_t, dim_t, dim_t),
+    int act = ACT_NONE,
+    int act_param = 0,
+    int frames = 1,
+    bool tlast_mode = false,
+    int chans = C_IN,
+    int wseed = 0
+) {
+    const int OH = H - KS + 1;
+    const int OW = W - KS + 1;
+
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > in_stream;
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > out_stream;
+
+    static conv_case<H, W, C_IN, C_OUT, KS> tc;
+    static data_t golden_out[OH][OW][C_OUT];
+    static data_t dut_out[OH][OW][C_OUT];
+
+    //运行DUT, 一次调用处理整批帧
+    for (int f = 0; f < frames; f++) {
+        tc.init(act, act_param, f, chans, wseed);
+        pack_frame<BUS_W, H, W, C_IN>(tc.input, in_stream,
+                                      !tlast_mode || f == frames - 1);
+    }
+
+    double t0 = wall_ms();
+    dut(in_stream, out_stream, tc.wbus, tc.bias, tc.qmul, tc.qshift,
+        act, act_param, tlast_mode ? 0 : frames, H, W, chans);
+    double ms = wall_ms() - t0;
+
+    //逐帧运行golden并比较
+    for (int f = 0; f < frames; f++) {
+        tc.init(act, act_param, f, chans, wseed);
+        tc.golden(golden_out);
+
+        if (!unpack_frame<BUS_W, OH, OW, C_OUT>(out_stream, dut_out)) {
+            std::cout << name << " stream format error @frame " << f << std::endl;
+            return false;
+        }
+        if (!compare_maps<OH, OW, C_OUT>(name, dut_out, golden_out))
+            return false;
+    }
+
+    if (!in_stream.empty() || !out_stream.empty()) {
+        std::cout << name << " stream not drained" << std::endl;
+        return false;
+    }
+
+    report_pass(name, ms, (long long)frames * H * W);
+    return true;
+}
+
+//卷积+池化融合测试, golden 为卷积与池化两个参考模型级联
+template<int H, int W, int C_IN, int C_OUT, int KS, int PK, int PS, int BUS_W>
+bool run_pool_case(
+    const char *name,
+    void (*dut)(hls::stream<ap_axis<BUS_W, 0, 0, 0> > &,
+                hls::stream<ap_axis<BUS_W, 0, 0, 0> > &,
+                const wbus_t *, bias_t [C_OUT],
+                qmul_t [C_OUT], qshift_t [C_OUT], act_t, ap_uint<8>, pool_t,
+                ap_uint<32>, dim_t, dim_t, dim_t),
+    int pool_mode,
+    int act = ACT_NONE,
+    int act_param = 0,
+    int frames = 1,
+    bool tlast_mode = false
+) {
+    const int OH = H - KS + 1;
+    const int OW = W - KS + 1;
+    const int PH = (OH - PK) / PS + 1;
+    const int PW = (OW - PK) / PS + 1;
+
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > in_stream;
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > out_stream;
+
+    static conv_case<H, W, C_IN, C_OUT, KS> tc;
+    static data_t conv_out[OH][OW][C_OUT];
+    static data_t golden_out[PH][PW][C_OUT];
+    static data_t dut_out[PH][PW][C_OUT];
+
+    for (int f = 0; f < frames; f++) {
+        tc.init(act, act_param, f);
+        pack_frame<BUS_W, H, W, C_IN>(tc.input, in_stream,
+                                      !tlast_mode || f == frames - 1);
+    }
+
+    double t0 = wall_ms();
+    dut(in_stream, out_stream, tc.wbus, tc.bias, tc.qmul, tc.qshift,
+        act, act_param, pool_mode, tlast_mode ? 0 : frames, H, W, C_IN);
+    double ms = wall_ms() - t0;
+
+    for (int f = 0; f < frames; f++) {
+        tc.init(act, act_param, f);
+        tc.golden(conv_out);
+        golden_pool<OH, OW, C_OUT, PK, PS>(conv_out, golden_out, pool_mode);
+
+        if (!unpack_frame<BUS_W, PH, PW, C_OUT>(out_stream, dut_out)) {
+            std::cout << name << " stream format error @frame " << f << std::endl;
+            return false;
+        }
+        if (!compare_maps<PH, PW, C_OUT>(name, dut_out, golden_out))
+            return false;
+    }
+
+    if (!in_stream.empty() || !out_stream.empty()) {
+        std::cout << name << " stream not drained" << std::endl;
+        return false;
+    }
+
+    report_pass(name, ms, (long long)frames * H * W);
+    return true;
+}
+
+//列分块测试: IMG_W 宽的图像按 TILE_W 宽的竖条送入 DUT, 拼接后与整图 golden 比较
+template<int H, int IMG_W, int TILE_W, int C_IN, int C_OUT, int KS, int BUS_W>
+bool run_tiled_case(
+    const char *name,
+    void (*dut)(hls::stream<ap_axis<BUS_W, 0, 0, 0> > &,
+                hls::stream<ap_axis<BUS_W, 0, 0, 0> > &,
+                const wbus_t *, bias_t [C_OUT],
+                qmul_t [C_OUT], qshift_t [C_OUT], act_t, ap_uint<8>,
+                ap_uint<32>, dim_t, dim_t, dim_t),
+    int act = ACT_NONE,
+    int act_param = 0
+) {
+    const int OH = H - KS + 1;
+    const int OW = IMG_W - KS + 1;
+
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > in_stream;
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > out_stream;
+
+    static conv_case<H, IMG_W, C_IN, C_OUT, KS> tc;
+    static data_t golden_out[OH][OW][C_OUT];
+    static data_t dut_out[OH][OW][C_OUT];
+
+    tc.init(act, act_param);
+    tile_plan plan(IMG_W, TILE_W, KS);
+
+    split_tiles<BUS_W, H, IMG_W, TILE_W, C_IN>(tc.input, plan, in_stream);
+    dut(in_stream, out_stream, tc.wbus, tc.bias, tc.qmul, tc.qshift,
+        act, act_param, plan.tiles, H, TILE_W, C_IN);
+
+    tc.golden(golden_out);
+    if (!stitch_tiles<BUS_W, OH, OW, TILE_W - KS + 1, C_OUT>(out_stream, plan,
+                                                             dut_out)) {
+        std::cout << name << " stream format error" << std::endl;
+        return false;
+    }
+    if (!compare_maps<OH, OW, C_OUT>(name, dut_out, golden_out))
+        return false;
+
+    if (!in_stream.empty() || !out_stream.empty()) {
+        std::cout << name << " stream not drained" << std::endl;
+        return false;
+    }
+
+    std::cout << name << " passed (" << plan.tiles << " tiles)" << std::endl;
+    return true;
+}
+
+//三层级联测试, golden 为三个卷积参考模型级联
+template<class L1, class L2, class L3, int BUS_W>
+bool run_chain_case(
+    const char *name,
+    void (*dut)(hls::stream<ap_axis<BUS_W, 0, 0, 0> > &,
+                hls::stream<ap_axis<BUS_W, 0, 0, 0> > &,
+                const wbus_t *, bias_t [L1::C_OUT],
+                qmul_t [L1::C_OUT], qshift_t [L1::C_OUT], act_t, ap_uint<8>,
+                const wbus_t *, bias_t [L2::C_OUT],
+                qmul_t [L2::C_OUT], qshift_t [L2::C_OUT], act_t, ap_uint<8>,
+                const wbus_t *, bias_t [L3::C_OUT],
+                qmul_t [L3::C_OUT], qshift_t [L3::C_OUT], act_t, ap_uint<8>,
+                ap_uint<32>, dim_t, dim_t, dim_t)
+) {
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > in_stream;
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > out_stream;
+
+    static conv_case<L1::H, L1::W, L1::C_IN, L1::C_OUT, L1::KS> c1;
+    static conv_case<L2::H, L2::W, L2::C_IN, L2::C_OUT, L2::KS> c2;
+    static conv_case<L3::H, L3::W, L3::C_IN, L3::C_OUT, L3::KS> c3;
+    static data_t o1[L1::OH][L1::OW][L1::C_OUT];
+    static data_t o2[L2::OH][L2::OW][L2::C_OUT];
+    static data_t golden_out[L3::OH][L3::OW][L3::C_OUT];
+    static data_t dut_out[L3::OH][L3::OW][L3::C_OUT];
+
+    c1.init(ACT_RELU, 0);
+    c2.init(ACT_LEAKY, 32);
+    c3.init(ACT_NONE, 0);
+
+    //后级输入已是 int8 特征图, 缩小缩放系数以免全部饱和
+    for (int co = 0; co < L2::C_OUT; co++)
+        c2.qshift[co] += 4;
+    for (int co = 0; co < L3::C_OUT; co++)
+        c3.qshift[co] += 2;
+
+    golden_conv<L1::H, L1::W, L1::C_IN, L1::C_OUT, L1::KS>(
+        c1.input, o1, c1.weight, c1.bias, c1.qmul, c1.qshift,
+        c1.act, c1.act_param);
+    golden_conv<L2::H, L2::W, L2::C_IN, L2::C_OUT, L2::KS>(
+        o1, o2, c2.weight, c2.bias, c2.qmul, c2.qshift,
+        c2.act, c2.act_param);
+    golden_conv<L3::H, L3::W, L3::C_IN, L3::C_OUT, L3::KS>(
+        o2, golden_out, c3.weight, c3.bias, c3.qmul, c3.qshift,
+        c3.act, c3.act_param);
+
+    pack_frame<BUS_W, L1::H, L1::W, L1::C_IN>(c1.input, in_stream);
+
+    double t0 = wall_ms();
+    dut(in_stream, out_stream,
+        c1.wbus, c1.bias, c1.qmul, c1.qshift, c1.act, c1.act_param,
+        c2.wbus, c2.bias, c2.qmul, c2.qshift, c2.act, c2.act_param,
+        c3.wbus, c3.bias, c3.qmul, c3.qshift, c3.act, c3.act_param,
+        1, L1::H, L1::W, L1::C_IN);
+    double ms = wall_ms() - t0;
+
+    if (!unpack_frame<BUS_W, L3::OH, L3::OW, L3::C_OUT>(out_stream, dut_out)) {
+        std::cout << name << " stream format error" << std::endl;
+        return false;
+    }
+
+    if (!compare_maps<L3::OH, L3::OW, L3::C_OUT>(name, dut_out, golden_out))
+        return false;
+
+    report_pass(name, ms, (long long)L1::H * L1::W);
+    return true;
+}
+
+//两层级联测试, golden 为两个卷积参考模型级联
+template<class L1, class L2, int BUS_W>
+bool run_chain2_case(
+    const char *name,
+    void (*dut)(hls::stream<ap_axis<BUS_W, 0, 0, 0> > &,
+                hls::stream<ap_axis<BUS_W, 0, 0, 0> > &,
+                const wbus_t *, bias_t [L1::C_OUT],
+                qmul_t [L1::C_OUT], qshift_t [L1::C_OUT], act_t, ap_uint<8>,
+                const wbus_t *, bias_t [L2::C_OUT],
+                qmul_t [L2::C_OUT], qshift_t [L2::C_OUT], act_t, ap_uint<8>,
+                ap_uint<32>, dim_t, dim_t, dim_t)
+) {
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > in_stream;
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > out_stream;
+
+    static conv_case<L1::H, L1::W, L1::C_IN, L1::C_OUT, L1::KS> c1;
+    static conv_case<L2::H, L2::W, L2::C_IN, L2::C_OUT, L2::KS> c2;
+    static data_t o1[L1::OH][L1::OW][L1::C_OUT];
+    static data_t golden_out[L2::OH][L2::OW][L2::C_OUT];
+    static data_t dut_out[L2::OH][L2::OW][L2::C_OUT];
+
+    c1.init(ACT_RELU, 0);
+    c2.init(ACT_NONE, 0);
+    for (int co = 0; co < L2::C_OUT; co++)
+        c2.qshift[co] += 4;
+
+    golden_conv<L1::H, L1::W, L1::C_IN, L1::C_OUT, L1::KS>(
+        c1.input, o1, c1.weight, c1.bias, c1.qmul, c1.qshift,
+        c1.act, c1.act_param);
+    golden_conv<L2::H, L2::W, L2::C_IN, L2::C_OUT, L2::KS>(
+        o1, golden_out, c2.weight, c2.bias, c2.qmul, c2.qshift,
+        c2.act, c2.act_param);
+
+    pack_frame<BUS_W, L1::H, L1::W, L1::C_IN>(c1.input, in_stream);
+
+    double t0 = wall_ms();
+    dut(in_stream, out_stream,
+        c1.wbus, c1.bias, c1.qmul, c1.qshift, c1.act, c1.act_param,
+        c2.wbus, c2.bias, c2.qmul, c2.qshift, c2.act, c2.act_param,
+        1, L1::H, L1::W, L1::C_IN);
+    double ms = wall_ms() - t0;
+
+    if (!unpack_frame<BUS_W, L2::OH, L2::OW, L2::C_OUT>(out_stream, dut_out)) {
+        std::cout << name << " stream format error" << std::endl;
+        return false;
+    }
+
+    if (!compare_maps<L2::OH, L2::OW, L2::C_OUT>(name, dut_out, golden_out))
+        return false;
+
+    report_pass(name, ms, (long long)L1::H * L1::W);
+    return true;
+}
+
+//偏置轮流取 int32 最大值 / 最小值 / 原值, 检查偏置相加不回绕
+void set_edge_bias(bias_t *bias, int n) {
+    for (int i = 0; i < n; i++) {
+        if (i % 3 == 0)
+            bias[i] = 2147483647;
+        else if (i % 3 == 1)
+            bias[i] = -2147483647 - 1;
+    }
+}
+
+//深度可分离卷积测试, golden 为逐通道与逐点 (1x1 golden_conv) 两个参考模型级联.
+//edge 时两级偏置都按 set_edge_bias 取边界值
+template<int H, int W, int C, int C_OUT, int KS, int BUS_W>
+bool run_dwsep_case(
+    const char *name,
+    void (*dut)(hls::stream<ap_axis<BUS_W, 0, 0, 0> > &,
+                hls::stream<ap_axis<BUS_W, 0, 0, 0> > &,
+                const wbus_t *, bias_t [C], qmul_t [C], qshift_t [C],
+                act_t, ap_uint<8>,
+                const wbus_t *, bias_t [C_OUT], qmul_t [C_OUT], qshift_t [C_OUT],
+                act_t, ap_uint<8>,
+                ap_uint<32>, dim_t, dim_t, dim_t),
+    int frames = 1,
+    bool edge = false
+) {
+    const int OH = H - KS + 1;
+    const int OW = W - KS + 1;
+    const int DW_WORDS = (C * KS * KS * DATA_W + WBUS_W - 1) / WBUS_W;
+
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > in_stream;
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > out_stream;
+
+    //逐通道权重取 conv_case 权重的对角部分
+    static conv_case<H, W, C, C, KS> dw;
+    static conv_case<OH, OW, C, C_OUT, 1> pw;
+    static data_t dw_weight[C][KS][KS];
+    static wbus_t dw_wbus[DW_WORDS];
+    static data_t dw_out[OH][OW][C];
+    static data_t golden_out[OH][OW][C_OUT];
+    static data_t dut_out[OH][OW][C_OUT];
+
+    pw.init(ACT_LEAKY, 32);
+    for (int co = 0; co < C_OUT; co++)
+        pw.qshift[co] += 2;
+    if (edge)
+        set_edge_bias(pw.bias, C_OUT);
+
+    for (int f = 0; f < frames; f++) {
+        dw.init(ACT_RELU, 0, f);
+        pack_frame<BUS_W, H, W, C>(dw.input, in_stream);
+    }
+    if (edge)
+        set_edge_bias(dw.bias, C);
+    for (int c = 0; c < C; c++) {
+        for (int ky = 0; ky < KS; ky++) {
+            for (int kx = 0; kx < KS; kx++) {
+                dw_weight[c][ky][kx] = dw.weight[c][ky][kx][c];
+            }
+        }
+    }
+    pack_weights<C * KS * KS>(&dw_weight[0][0][0], dw_wbus);
+
+    double t0 = wall_ms();
+    dut(in_stream, out_stream,
+        dw_wbus, dw.bias, dw.qmul, dw.qshift, dw.act, dw.act_param,
+        pw.wbus, pw.bias, pw.qmul, pw.qshift, pw.act, pw.act_param,
+        frames, H, W, C);
+    double ms = wall_ms() - t0;
+
+    for (int f = 0; f < frames; f++) {
+        dw.init(ACT_RELU, 0, f);
+        if (edge)
+            set_edge_bias(dw.bias, C);
+        golden_dwconv<H, W, C, KS>(dw.input, dw_out, dw_weight, dw.bias,
+                                   dw.qmul, dw.qshift, dw.act, dw.act_param);
+        golden_conv<OH, OW, C, C_OUT, 1>(dw_out, golden_out, pw.weight, pw.bias,
+                                         pw.qmul, pw.qshift, pw.act, pw.act_param);
+
+        if (!unpack_frame<BUS_W, OH, OW, C_OUT>(out_stream, dut_out)) {
+            std::cout << name << " stream format error @frame " << f << std::endl;
+            return false;
+        }
+        if (!compare_maps<OH, OW, C_OUT>(name, dut_out, golden_out))
+            return false;
+    }
+
+    if (!in_stream.empty() || !out_stream.empty()) {
+        std::cout << name << " stream not drained" << std::endl;
+        return false;
+    }
+
+    report_pass(name, ms, (long long)frames * H * W);
+    return true;
+}
+
+//补零/步长/膨胀测试, 补零圈数与步长在测试中取编译时常数.
+//reg_stride / reg_pad 为写入寄存器的值, 缺省与 S / P 相同; 取非法值时
+//DUT 应按 S / P (修正后的值) 计算
+template<int H, int W, int C_IN, int C_OUT, int KS, int DIL, int S, int P, int BUS_W>
+bool run_ext_case(
+    const char *name,
+    void (*dut)(hls::stream<ap_axis<BUS_W, 0, 0, 0> > &,
+                hls::stream<ap_axis<BUS_W, 0, 0, 0> > &,
+                const wbus_t *, bias_t [C_OUT],
+                qmul_t [C_OUT], qshift_t [C_OUT], act_t, ap_uint<8>,
+                ap_uint<32>, dim_t, dim_t, dim_t, stride_t, dim_t),
+    int act = ACT_NONE,
+    int act_param = 0,
+    int frames = 1,
+    int reg_stride = S,
+    int reg_pad = P
+) {
+    const int OH = (H + 2 * P - (KS - 1) * DIL - 1) / S + 1;
+    const int OW = (W + 2 * P - (KS - 1) * DIL - 1) / S + 1;
+
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > in_stream;
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > out_stream;
+
+    static conv_case<H, W, C_IN, C_OUT, KS> tc;
+    static data_t golden_out[OH][OW][C_OUT];
+    static data_t dut_out[OH][OW][C_OUT];
+
+    for (int f = 0; f < frames; f++) {
+        tc.init(act, act_param, f);
+        pack_frame<BUS_W, H, W, C_IN>(tc.input, in_stream);
+    }
+
+    double t0 = wall_ms();
+    dut(in_stream, out_stream, tc.wbus, tc.bias, tc.qmul, tc.qshift,
+        act, act_param, frames, H, W, C_IN, reg_stride, reg_pad);
+    double ms = wall_ms() - t0;
+
+    for (int f = 0; f < frames; f++) {
+        tc.init(act, act_param, f);
+        golden_conv_ext<H, W, C_IN, C_OUT, KS, DIL, S, P>(
+            tc.input, golden_out, tc.weight, tc.bias, tc.qmul, tc.qshift,
+            act, act_param);
+
+        if (!unpack_frame<BUS_W, OH, OW, C_OUT>(out_stream, dut_out)) {
+            std::cout << name << " stream format error @frame " << f << std::endl;
+            return false;
+        }
+        if (!compare_maps<OH, OW, C_OUT>(name, dut_out, golden_out))
+            return false;
+    }
+
+    if (!in_stream.empty() || !out_stream.empty()) {
+        std::cout << name << " stream not drained" << std::endl;
+        return false;
+    }
+
+    report_pass(name, ms, (long long)frames * H * W);
+    return true;
+}
+
+//每帧 n 个像素占用的拍数, 与 axis_unpack / axis_pack 的打包方式相同
+int frame_beats(int n, int c, int bus_w) {
+    int lanes = bus_w / DATA_W;
+    if (lanes >= c)
+        return (n + lanes / c - 1) / (lanes / c);
+    return n * ((c + lanes - 1) / lanes);
+}
+
+void print_perf(const char *name, const axis_perf &in, const axis_perf &out) {
+    std::cout << name << ": in beats " << in.beats << " stall " << in.stall
+              << " cycles " << in.cycles << " frame " << in.frame_cycles
+              << ", out beats " << out.beats << " stall " << out.stall
+              << " cycles " << out.cycles << " frame " << out.frame_cycles
+              << std::endl;
+}
+
+/*
+ * 性能计数测试: 计数版本的结果须与不计数时相同, 拍数须与帧格式一致.
+ * C 仿真中数据流各级依次执行, 输入事先全部写入, out_stream 不会满,
+ * 所以两侧 stall 均为 0, cycles 为循环次数.
+ */
+template<int H, int W, int C_IN, int C_OUT, int KS, int BUS_W>
+bool run_perf_case(const char *name, int frames, int act = ACT_NONE,
+                   int act_param = 0) {
+    const int OH = H - KS + 1;
+    const int OW = W - KS + 1;
+
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > in_stream;
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > out_stream;
+
+    static conv_case<H, W, C_IN, C_OUT, KS> tc;
+    static data_t golden_out[OH][OW][C_OUT];
+    static data_t dut_out[OH][OW][C_OUT];
+    axis_perf perf_in;
+    axis_perf perf_out;
+
+    for (int f = 0; f < frames; f++) {
+        tc.init(act, act_param, f);
+        pack_frame<BUS_W, H, W, C_IN>(tc.input, in_stream);
+    }
+
+    double t0 = wall_ms();
+    conv_ext_perf_axis<H, W, C_IN, C_OUT, KS, 1, 0, BUS_W, true>(
+        in_stream, out_stream, tc.wbus, tc.bias, tc.qmul, tc.qshift,
+        act, act_param, frames, H, W, C_IN, 1, 0, perf_in, perf_out);
+    double ms = wall_ms() - t0;
+
+    for (int f = 0; f < frames; f++) {
+        tc.init(act, act_param, f);
+        tc.golden(golden_out);
+
+        if (!unpack_frame<BUS_W, OH, OW, C_OUT>(out_stream, dut_out)) {
+            std::cout << name << " stream format error @frame " << f << std::endl;
+            return false;
+        }
+        if (!compare_maps<OH, OW, C_OUT>(name, dut_out, golden_out))
+            return false;
+    }
+
+    print_perf(name, perf_in, perf_out);
+    int in_beats = frames * frame_beats(H * W, C_IN, BUS_W);
+    int out_beats = frames * frame_beats(OH * OW, C_OUT, BUS_W);
+    if (perf_in.beats != in_beats || perf_out.beats != out_beats ||
+        perf_in.stall != 0 || perf_out.stall != 0 ||
+        perf_out.cycles < perf_out.beats || perf_out.frame_cycles == 0) {
+        std::cout << name << " bad counters, expected beats " << in_beats
+                  << " / " << out_beats << std::endl;
+        return false;
+    }
+
+    report_pass(name, ms, (long long)frames * H * W);
+    return true;
+}
+
+//常数权重测试: golden_conv 使用与 DUT 相同的滤波器组权重
+template<int H, int W, class F, int BUS_W>
+bool run_const_case(
+    const char *name,
+    int act = ACT_NONE,
+    int act_param = 0,
+    int frames = 1,
+    int chans = F::C_IN
+) {
+    const int OH = H - F::KS + 1;
+    const int OW = W - F::KS + 1;
+
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > in_stream;
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > out_stream;
+
+    static conv_case<H, W, F::C_IN, F::C_OUT, F::KS> tc;
+    static data_t golden_out[OH][OW][F::C_OUT];
+    static data_t dut_out[OH][OW][F::C_OUT];
+
+    for (int f = 0; f < frames; f++) {
+        tc.init(act, act_param, f, chans);
+        pack_frame<BUS_W, H, W, F::C_IN>(tc.input, in_stream);
+    }
+
+    const_conv_axis<H, W, F, BUS_W>(in_stream, out_stream, 0, tc.bias,
+                                    tc.qmul, tc.qshift, act, act_param,
+                                    frames, H, W, chans);
+
+    for (int f = 0; f < frames; f++) {
+        tc.init(act, act_param, f, chans);
+        tc.template use_bank<F>();
+        tc.golden(golden_out);
+
+        if (!unpack_frame<BUS_W, OH, OW, F::C_OUT>(out_stream, dut_out)) {
+            std::cout << name << " stream format error @frame " << f << std::endl;
+            return false;
+        }
+        if (!compare_maps<OH, OW, F::C_OUT>(name, dut_out, golden_out))
+            return false;
+    }
+
+    if (!in_stream.empty() || !out_stream.empty()) {
+        std::cout << name << " stream not drained" << std::endl;
+        return false;
+    }
+
+    std::cout << name << " passed" << std::endl;
+    return true;
+}
+
+//conv_case 的数据转为 host_conv 格式, 输入按帧追加
+template<int H, int W, int C_IN, int C_OUT, int KS>
+struct host_case_data {
+    std::vector<int8_t> weight;
+    std::vector<int32_t> bias;
+    std::vector<uint16_t> qmul;
+    std::vector<uint8_t> qshift;
+
+    host_conv_layer layer(const conv_case<H, W, C_IN, C_OUT, KS> &tc) {
+        weight.resize(C_OUT * KS * KS * C_IN);
+        bias.resize(C_OUT);
+        qmul.resize(C_OUT);
+        qshift.resize(C_OUT);
+        for (int i = 0; i < C_OUT * KS * KS * C_IN; i++)
+            weight[i] = (&tc.weight[0][0][0][0])[i].to_int();
+        for (int co = 0; co < C_OUT; co++) {
+            bias[co] = tc.bias[co].to_int();
+            qmul[co] = tc.qmul[co].to_uint();
+            qshift[co] = tc.qshift[co].to_uint();
+        }
+        host_conv_layer l = {H, W, C_IN, C_OUT, KS, &weight[0], &bias[0],
+                             &qmul[0], &qshift[0], tc.act, tc.act_param};
+        return l;
+    }
+
+    static void append_input(const conv_case<H, W, C_IN, C_OUT, KS> &tc,
+                             std::vector<int8_t> &in) {
+        for (int i = 0; i < H * W * C_IN; i++)
+            in.push_back((&tc.input[0][0][0])[i].to_int());
+    }
+};
+
+/*
+ * 主机参考卷积测试: golden_conv 与 host_conv 的每种指令集逐位比较,
+ * 并给出各自的耗时与相对 golden_conv 的加速比
+ */
+template<int H, int W, int C_IN, int C_OUT, int KS>
+bool run_host_case(
+    const char *name,
+    int act = ACT_NONE,
+    int act_param = 0,
+    int frames = 1
+) {
+    const int OH = H - KS + 1;
+    const int OW = W - KS + 1;
+    const int IN_N = H * W * C_IN;
+    const int OUT_N = OH * OW * C_OUT;
+
+    static conv_case<H, W, C_IN, C_OUT, KS> tc;
+    static data_t golden_out[OH][OW][C_OUT];
+    std::vector<int8_t> in(frames * IN_N);
+    std::vector<int8_t> golden(frames * OUT_N);
+    std::vector<int8_t> out(frames * OUT_N);
+
+    double golden_ms = 0;
+    for (int f = 0; f < frames; f++) {
+        tc.init(act, act_param, f);
+        for (int i = 0; i < IN_N; i++)
+            in[f * IN_N + i] = (&tc.input[0][0][0])[i].to_int();
+
+        double t0 = wall_ms();
+        tc.golden(golden_out);
+        golden_ms += wall_ms() - t0;
+
+        for (int i = 0; i < OUT_N; i++)
+            golden[f * OUT_N + i] = (&golden_out[0][0][0])[i].to_int();
+    }
+
+    host_case_data<H, W, C_IN, C_OUT, KS> hd;
+    host_conv_layer l = hd.layer(tc);
+
+    std::cout << name << ": golden " << golden_ms << " ms";
+    for (int isa = HOST_SCALAR; isa <= host_detect_isa(); isa++) {
+        double t0 = wall_ms();
+        host_conv(l, &in[0], &out[0], frames, isa);
+        double ms = wall_ms() - t0;
+
+        for (int i = 0; i < frames * OUT_N; i++) {
+            if (out[i] != golden[i]) {
+                std::cout << std::endl << name << " " << host_isa_name(isa)
+                          << " Mismatch @" << i << " host=" << (int)out[i]
+                          << " Golden=" << (int)golden[i] << std::endl;
+                return false;
+            }
+        }
+        std::cout << ", " << host_isa_name(isa) << " " << ms << " ms ("
+                  << golden_ms / ms << "x)";
+    }
+    std::cout << std::endl << name << " passed" << std::endl;
+    return true;
+}
+
+/*
+ * 大批量验证: ref_runner 多线程计算参考结果, 同时运行 DUT. DUT 返回后
+ * 按行块读取输出, 等待对应参考块完成后立即比较. 第 0 帧参考结果另与
+ * golden_conv 比较.
+ */
+template<int H, int W, int C_IN, int C_OUT, int KS, int BUS_W>
+bool run_batch_verify_case(
+    const char *name,
+    void (*dut)(hls::stream<ap_axis<BUS_W, 0, 0, 0> > &,
+                hls::stream<ap_axis<BUS_W, 0, 0, 0> > &,
+                const wbus_t *, bias_t [C_OUT],
+                qmul_t [C_OUT], qshift_t [C_OUT], act_t, ap_uint<8>,
+                ap_uint<32>, dim_t, dim_t, dim_t),
+    ref_runner &runner,
+    int frames,
+    int tile_rows,
+    int act = ACT_NONE,
+    int act_param = 0
+) {
+    const int OH = H - KS + 1;
+    const int OW = W - KS + 1;
 
-//Golden Reference用于对比
-void golden_conv(
-    data_t in[IN_H][IN_W][IN_C],
-    data_t out[OUT_H][OUT_W],
-    data_t weight[K][K][IN_C],
-    data_t bias
-) {
-    for (int y = 0; y < OUT_H; y++) {
-        for (int x = 0; x < OUT_W; x++) {
-            acc_t sum = bias;
-            for (int ky = 0; ky < K; ky++) {
-                for (int kx = 0; kx < K; kx++) {
-                    for (int c = 0; c < IN_C; c++) {
-                        sum += in[y + ky][x + kx][c] *
-                               weight[ky][kx][c];
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > in_stream;
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > out_stream;
+
+    static conv_case<H, W, C_IN, C_OUT, KS> tc;
+    static data_t golden_out[OH][OW][C_OUT];
+    host_case_data<H, W, C_IN, C_OUT, KS> hd;
+    std::vector<int8_t> in;
+    std::vector<int8_t> ref(frames * OH * OW * C_OUT);
+
+    double t0 = wall_ms();
+    for (int f = 0; f < frames; f++) {
+        tc.init(act, act_param, f);
+        pack_frame<BUS_W, H, W, C_IN>(tc.input, in_stream);
+        hd.append_input(tc, in);
+    }
+    tc.init(act, act_param, 0);
+    host_conv_layer l = hd.layer(tc);
+
+    //参考模型在后台计算, 与 DUT 仿真同时进行. guard 在 in / ref 之前析构,
+    //任何返回路径都先等本批结束
+    ref_batch_guard guard(runner);
+    runner.start(l, &in[0], &ref[0], frames, tile_rows, host_detect_isa());
+    dut(in_stream, out_stream, tc.wbus, tc.bias, tc.qmul, tc.qshift,
+        act, act_param, frames, H, W, C_IN);
+
+    //逐块比较
+    axis_pixel_reader<BUS_W, C_OUT> reader(out_stream, OH * OW);
+    int8_t pix[C_OUT];
+    for (int f = 0; f < frames; f++) {
+        for (int t = 0; t < runner.tiles_per_frame(); t++) {
+            runner.wait_tile(f, t);
+            int y0 = t * tile_rows;
+            int y1 = (y0 + tile_rows < OH) ? y0 + tile_rows : OH;
+
+            for (int y = y0; y < y1; y++) {
+                for (int x = 0; x < OW; x++) {
+                    if (!reader.read(pix))
+                        return false;
+                    const int8_t *r = &ref[((f * OH + y) * OW + x) * C_OUT];
+                    for (int c = 0; c < C_OUT; c++) {
+                        if (pix[c] != r[c]) {
+                            std::cout << name << " Mismatch @frame " << f
+                                      << " (" << y << "," << x << "," << c
+                                      << ") DUT=" << (int)pix[c]
+                                      << " Ref=" << (int)r[c] << std::endl;
+                            return false;
+                        }
                     }
                 }
             }
-            out[y][x] = (data_t)sum;
         }
     }
+    runner.wait_all();
+    double ms = wall_ms() - t0;
+
+    if (!in_stream.empty() || !out_stream.empty()) {
+        std::cout << name << " stream not drained" << std::endl;
+        return false;
+    }
+
+    tc.golden(golden_out);
+    for (int i = 0; i < OH * OW * C_OUT; i++) {
+        if (ref[i] != (&golden_out[0][0][0])[i].to_int()) {
+            std::cout << name << " reference differs from golden @" << i
+                      << std::endl;
+            return false;
+        }
+    }
+
+    std::cout << name << " passed (" << frames << " frames, "
+              << runner.tiles_per_frame() << " tiles/frame, "
+              << runner.threads() << " threads, " << runner.steals()
+              << " steals, " << ms << " ms)" << std::endl;
+    return true;
+}
+
+//参考模型单独计时: 1 个线程与 threads 个线程处理同一批帧, 结果须一致
+template<int H, int W, int C_IN, int C_OUT, int KS>
+bool run_runner_bench(const char *name, int frames, int tile_rows, int threads) {
+    const int OUT_N = (H - KS + 1) * (W - KS + 1) * C_OUT;
+
+    static conv_case<H, W, C_IN, C_OUT, KS> tc;
+    host_case_data<H, W, C_IN, C_OUT, KS> hd;
+    std::vector<int8_t> in;
+    std::vector<int8_t> ref1(frames * OUT_N);
+    std::vector<int8_t> refn(frames * OUT_N);
+
+    for (int f = 0; f < frames; f++) {
+        tc.init(ACT_RELU, 0, f);
+        hd.append_input(tc, in);
+    }
+    host_conv_layer l = hd.layer(tc);
+
+    double t0 = wall_ms();
+    {
+        ref_runner one(1);
+        one.start(l, &in[0], &ref1[0], frames, tile_rows, host_detect_isa());
+        one.wait_all();
+    }
+    double ms1 = wall_ms() - t0;
+
+    ref_runner many(threads);
+    t0 = wall_ms();
+    many.start(l, &in[0], &refn[0], frames, tile_rows, host_detect_isa());
+    many.wait_all();
+    double msn = wall_ms() - t0;
+
+    if (ref1 != refn) {
+        std::cout << name << " results differ between thread counts" << std::endl;
+        return false;
+    }
+    std::cout << name << " passed (" << frames << " frames, 1 thread "
+              << ms1 << " ms, " << many.threads() << " threads " << msn
+              << " ms, " << ms1 / msn << "x, " << many.steals() << " steals)"
+              << std::endl;
+    return true;
 }
 
-int main() {
+//线性同余随机数, 每个测试点只依赖种子, 便于复现
+struct test_rng {
+    unsigned state;
+
+    explicit test_rng(unsigned seed) : state(seed * 2654435761u + 1) {}
+
+    unsigned next() {
+        state = state * 1103515245u + 12345u;
+        return state >> 8;
+    }
+
+    //[lo, hi] 内的整数
+    int range(int lo, int hi) {
+        return lo + (int)(next() % (unsigned)(hi - lo + 1));
+    }
+
+    //从 n 个候选值中取一个
+    int pick(const int *vals, int n) {
+        return vals[next() % (unsigned)n];
+    }
+};
+
+/*
+ * 随机回归: DUT 按上限 H x W x C_IN 实例化, 每次迭代随机选择运行时尺寸
+ * rows / cols / chans、帧数、批结束方式、激活函数、权重与量化参数.
+ * edge 时输入与权重只取 -128 / -127 / 0 / 127 等边界值, 偏置可达 int32
+ * 边界, 覆盖饱和与溢出路径. 参考结果由 host_conv 计算 (与 golden_conv
+ * 逐位一致, 见 run_host_case). 失败时打印种子与该次迭代的参数.
+ * even 时 rows / cols 只取偶数 (Winograd 顶层的要求).
+ */
+template<int H, int W, int C_IN, int C_OUT, int KS, int BUS_W>
+bool run_random_case(
+    const char *name,
+    void (*dut)(hls::stream<ap_axis<BUS_W, 0, 0, 0> > &,
+                hls::stream<ap_axis<BUS_W, 0, 0, 0> > &,
+                const wbus_t *, bias_t [C_OUT],
+                qmul_t [C_OUT], qshift_t [C_OUT], act_t, ap_uint<8>,
+                ap_uint<32>, dim_t, dim_t, dim_t),
+    unsigned seed,
+    int iters,
+    bool edge,
+    bool even = false
+) {
+    const int WEIGHTS = C_OUT * KS * KS * C_IN;
+    static const int EDGE_IN[] = {-128, -127, -1, 0, 1, 127};
+    static const int EDGE_W[] = {-128, 127, -1, 1};
+
+    double total_ms = 0;
+    long long total_pix = 0;
+
+    for (int it = 0; it < iters; it++) {
+        test_rng rng(seed + 7919u * it);
+        int rows = even ? 2 * rng.range((KS + 1) / 2, H / 2) : rng.range(KS, H);
+        int cols = even ? 2 * rng.range((KS + 1) / 2, W / 2) : rng.range(KS, W);
+        int chans = rng.range(1, C_IN);
+        int frames = rng.range(1, 3);
+        bool tlast_mode = rng.range(0, 1);
+        int act = rng.range(ACT_NONE, ACT_LEAKY);
+        int act_param = rng.range(0, 255);
+        int oh = rows - KS + 1;
+        int ow = cols - KS + 1;
+
+        std::vector<data_t> weight(WEIGHTS);
+        std::vector<int8_t> w8(WEIGHTS);
+        for (int i = 0; i < WEIGHTS; i++) {
+            w8[i] = edge ? rng.pick(EDGE_W, 4) : rng.range(-128, 127);
+            weight[i] = w8[i];
+        }
+        static wbus_t wbus[(WEIGHTS * DATA_W + WBUS_W - 1) / WBUS_W];
+        pack_weights<WEIGHTS>(&weight[0], wbus);
+
+        //缩放使典型累加值落在 int8 附近, 部分通道饱和
+        bias_t bias[C_OUT];
+        qmul_t qmul[C_OUT];
+        qshift_t qshift[C_OUT];
+        std::vector<int32_t> b32(C_OUT);
+        std::vector<uint16_t> m16(C_OUT);
+        std::vector<uint8_t> s8(C_OUT);
+        for (int co = 0; co < C_OUT; co++) {
+            if (edge && rng.range(0, 3) == 0)
+                b32[co] = rng.range(0, 1) ? 2147483647 : -2147483647 - 1;
+            else
+                b32[co] = rng.range(-100000, 100000);
+            m16[co] = edge ? (rng.range(0, 1) ? 65535 : 1) : rng.range(1, 65535);
+            s8[co] = rng.range(edge ? 0 : 14, edge ? 47 : 26);
+            bias[co] = b32[co];
+            qmul[co] = m16[co];
+            qshift[co] = s8[co];
+        }
 
-    hls::stream<axis_t> in_stream;
-    hls::stream<axis_t> out_stream;
+        //输入: 流中为全部 C_IN 个通道, 参考模型中 chans 之后的通道为 0
+        hls::stream<ap_axis<BUS_W, 0, 0, 0> > in_stream;
+        hls::stream<ap_axis<BUS_W, 0, 0, 0> > out_stream;
+        axis_pixel_writer<BUS_W, C_IN> writer(in_stream, rows * cols);
+        std::vector<int8_t> in(frames * rows * cols * C_IN);
+        for (int f = 0; f < frames; f++) {
+            for (int p = 0; p < rows * cols; p++) {
+                int8_t pix[C_IN];
+                for (int c = 0; c < C_IN; c++) {
+                    pix[c] = edge ? rng.pick(EDGE_IN, 6) : rng.range(-128, 127);
+                    in[(f * rows * cols + p) * C_IN + c] = (c < chans) ? pix[c] : 0;
+                }
+                writer.write(pix, !tlast_mode || f == frames - 1);
+            }
+        }
 
-    data_t input[IN_H][IN_W][IN_C];
-    data_t weight[K][K][IN_C];
-    data_t bias = 1;
+        host_conv_layer l = {rows, cols, C_IN, C_OUT, KS, &w8[0], &b32[0],
+                             &m16[0], &s8[0], act, act_param};
+        std::vector<int8_t> ref(frames * oh * ow * C_OUT);
+        host_conv(l, &in[0], &ref[0], frames, host_detect_isa());
 
-    data_t golden_out[OUT_H][OUT_W];
+        double t0 = wall_ms();
+        dut(in_stream, out_stream, wbus, bias, qmul, qshift, act, act_param,
+            tlast_mode ? 0 : frames, rows, cols, chans);
+        total_ms += wall_ms() - t0;
+        total_pix += (long long)frames * rows * cols;
 
-    //初始化输入
-    for (int y = 0; y < IN_H; y++) {
-        for (int x = 0; x < IN_W; x++) {
-            for (int c = 0; c < IN_C; c++) {
-                input[y][x][c] = y + x + c;
+        axis_pixel_reader<BUS_W, C_OUT> reader(out_stream, oh * ow);
+        bool ok = true;
+        for (int i = 0; ok && i < frames * oh * ow; i++) {
+            int8_t pix[C_OUT];
+            ok = reader.read(pix);
+            for (int c = 0; ok && c < C_OUT; c++) {
+                if (pix[c] != ref[i * C_OUT + c]) {
+                    std::cout << name << " Mismatch @pixel " << i << " ch " << c
+                              << " DUT=" << (int)pix[c]
+                              << " Ref=" << (int)ref[i * C_OUT + c] << std::endl;
+                    ok = false;
+                }
             }
         }
+        if (ok && (!in_stream.empty() || !out_stream.empty())) {
+            std::cout << name << " stream not drained" << std::endl;
+            ok = false;
+        }
+        if (!ok) {
+            std::cout << name << " failed: case seed " << seed << " iter " << it
+                      << " rows " << rows << " cols " << cols << " chans "
+                      << chans << " frames " << frames << " tlast " << tlast_mode
+                      << " act " << act << "/" << act_param << std::endl;
+            return false;
+        }
+    }
+
+    report_pass(name, total_ms, total_pix);
+    return true;
+}
+
+/*
+ * 尺寸寄存器非法值: 写入 reg_rows / reg_cols, DUT 应按修正后的 rows x cols
+ * 处理 (见 dim_clamp), 输入流也按修正后的尺寸给出. 参考结果由 host_conv
+ * 在 rows x cols 上计算.
+ */
+template<int H, int W, int C_IN, int C_OUT, int KS, int BUS_W>
+bool run_dims_case(
+    const char *name,
+    void (*dut)(hls::stream<ap_axis<BUS_W, 0, 0, 0> > &,
+                hls::stream<ap_axis<BUS_W, 0, 0, 0> > &,
+                const wbus_t *, bias_t [C_OUT],
+                qmul_t [C_OUT], qshift_t [C_OUT], act_t, ap_uint<8>,
+                ap_uint<32>, dim_t, dim_t, dim_t),
+    int reg_rows,
+    int reg_cols,
+    int rows,
+    int cols,
+    int frames = 2
+) {
+    const int WEIGHTS = C_OUT * KS * KS * C_IN;
+    int oh = rows - KS + 1;
+    int ow = cols - KS + 1;
+    test_rng rng(reg_rows * 131u + reg_cols);
+
+    std::vector<data_t> weight(WEIGHTS);
+    std::vector<int8_t> w8(WEIGHTS);
+    for (int i = 0; i < WEIGHTS; i++) {
+        w8[i] = rng.range(-128, 127);
+        weight[i] = w8[i];
+    }
+    static wbus_t wbus[(WEIGHTS * DATA_W + WBUS_W - 1) / WBUS_W];
+    pack_weights<WEIGHTS>(&weight[0], wbus);
+
+    bias_t bias[C_OUT];
+    qmul_t qmul[C_OUT];
+    qshift_t qshift[C_OUT];
+    std::vector<int32_t> b32(C_OUT);
+    std::vector<uint16_t> m16(C_OUT);
+    std::vector<uint8_t> s8(C_OUT);
+    for (int co = 0; co < C_OUT; co++) {
+        bias[co] = b32[co] = rng.range(-100000, 100000);
+        qmul[co] = m16[co] = rng.range(1, 65535);
+        qshift[co] = s8[co] = rng.range(14, 26);
     }
 
-    //初始化权重
-    for (int ky = 0; ky < K; ky++) {
-        for (int kx = 0; kx < K; kx++) {
-            for (int c = 0; c < IN_C; c++) {
-                weight[ky][kx][c] = 1;
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > in_stream;
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > out_stream;
+    axis_pixel_writer<BUS_W, C_IN> writer(in_stream, rows * cols);
+    std::vector<int8_t> in(frames * rows * cols * C_IN);
+    for (int p = 0; p < frames * rows * cols; p++) {
+        int8_t pix[C_IN];
+        for (int c = 0; c < C_IN; c++)
+            in[p * C_IN + c] = pix[c] = rng.range(-128, 127);
+        writer.write(pix, true);
+    }
+
+    host_conv_layer l = {rows, cols, C_IN, C_OUT, KS, &w8[0], &b32[0],
+                         &m16[0], &s8[0], ACT_RELU, 0};
+    std::vector<int8_t> ref(frames * oh * ow * C_OUT);
+    host_conv(l, &in[0], &ref[0], frames, host_detect_isa());
+
+    double t0 = wall_ms();
+    dut(in_stream, out_stream, wbus, bias, qmul, qshift, ACT_RELU, 0, frames,
+        reg_rows, reg_cols, C_IN);
+    double ms = wall_ms() - t0;
+
+    axis_pixel_reader<BUS_W, C_OUT> reader(out_stream, oh * ow);
+    for (int i = 0; i < frames * oh * ow; i++) {
+        int8_t pix[C_OUT];
+        if (!reader.read(pix)) {
+            std::cout << name << " output too short @pixel " << i << std::endl;
+            return false;
+        }
+        for (int c = 0; c < C_OUT; c++) {
+            if (pix[c] != ref[i * C_OUT + c]) {
+                std::cout << name << " Mismatch @pixel " << i << " ch " << c
+                          << " DUT=" << (int)pix[c]
+                          << " Ref=" << (int)ref[i * C_OUT + c] << std::endl;
+                return false;
             }
         }
     }
+    if (!in_stream.empty() || !out_stream.empty()) {
+        std::cout << name << " stream not drained" << std::endl;
+        return false;
+    }
+
+    report_pass(name, ms, (long long)frames * rows * cols);
+    return true;
+}
+
+/*
+ * 位宽组合测试, P 为 prec<A_W, W_W, O_W, B_W>
+ * 数据取满各自位宽的范围; extreme 时输入与权重全取最小值, 乘积之和达到
+ * acc_width 所按的上界. shift_add 加到各通道的 qshift 上 (最大 63),
+ * 用于检查 qshift 不小于输出级乘积位宽时的情况.
+ */
+template<int H, int W, int C_IN, int C_OUT, int KS, class P>
+struct prec_case {
+    static const int WEIGHTS = C_OUT * KS * KS * C_IN;
+    static const int WORDS = (WEIGHTS + WBUS_W / P::W_W - 1) / (WBUS_W / P::W_W);
+
+    ap_int<P::A_W> input[H][W][C_IN];
+    ap_int<P::W_W> weight[C_OUT][KS][KS][C_IN];
+    wbus_t wbus[WORDS];
+    ap_int<P::B_W> bias[C_OUT];
+    qmul_t qmul[C_OUT];
+    qshift_t qshift[C_OUT];
+
+    //线性同余序列映射到 bits 位有符号数
+    static long long draw(unsigned &seed, int bits) {
+        seed = seed * 1103515245u + 12345u;
+        return (long long)((seed >> 8) & ((1u << bits) - 1)) - (1LL << (bits - 1));
+    }
 
-    //运行golden
-    golden_conv(input, golden_out, weight, bias);
+    //权重与偏置每次相同, 输入随帧变化
+    void init(int frame, bool extreme, int shift_add = 0) {
+        unsigned seed = 7 + 131 * frame;
+        unsigned wseed = 3;
+        typedef acc_width<P::A_W + P::W_W, P::B_W, KS * KS * C_IN> ACC;
 
-    //运行DUT
-    for (int y = 0; y < IN_H; y++) {
-        for (int x = 0; x < IN_W; x++) {
-            for (int c = 0; c < IN_C; c++) {
-                axis_t in;
-                in.data = (ap_uint<8>)input[y][x][c];
-                in.keep = -1;
-                in.last = (y == IN_H - 1 &&
-                           x == IN_W - 1 &&
-                           c == IN_C - 1);
-                in_stream.write(in);
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                for (int c = 0; c < C_IN; c++) {
+                    input[y][x][c] = extreme ? -(1LL << (P::A_W - 1))
+                                             : draw(seed, P::A_W);
+                }
+            }
+        }
+
+        //缩放系数使输出大致落在 O_W 位范围内, 部分通道饱和
+        for (int co = 0; co < C_OUT; co++) {
+            int bias_w = (P::B_W < ACC::SUM_W) ? P::B_W : ACC::SUM_W;
+            bias[co] = extreme ? 0 : draw(wseed, bias_w < 24 ? bias_w : 24);
+            qmul[co] = 1 << 14;
+            int s = 14 + ACC::SUM_W - P::O_W - co % 3 + shift_add;
+            qshift[co] = (s > 63) ? 63 : s;
+            for (int ky = 0; ky < KS; ky++) {
+                for (int kx = 0; kx < KS; kx++) {
+                    for (int c = 0; c < C_IN; c++) {
+                        weight[co][ky][kx][c] = extreme ? -(1LL << (P::W_W - 1))
+                                                        : draw(wseed, P::W_W);
+                    }
+                }
+            }
+        }
+        pack_weights<WEIGHTS>(&weight[0][0][0][0], wbus);
+    }
+
+    void golden(ap_int<P::O_W> out[H - KS + 1][W - KS + 1][C_OUT], int act,
+                int act_param) {
+        for (int y = 0; y < H - KS + 1; y++) {
+            for (int x = 0; x < W - KS + 1; x++) {
+                for (int co = 0; co < C_OUT; co++) {
+                    long long sum = bias[co].to_int64();
+                    for (int ky = 0; ky < KS; ky++) {
+                        for (int kx = 0; kx < KS; kx++) {
+                            for (int c = 0; c < C_IN; c++) {
+                                sum += input[y + ky][x + kx][c].to_int64() *
+                                       weight[co][ky][kx][c].to_int64();
+                            }
+                        }
+                    }
+                    out[y][x][co] = golden_requant(sum, qmul[co], qshift[co],
+                                                   act, act_param, P::O_W);
+                }
             }
         }
     }
+};
 
-    cnn_conv_layer(in_stream, out_stream, weight, bias);
+template<int H, int W, int C_IN, int C_OUT, int KS, class P, int BUS_W>
+bool run_prec_case(
+    const char *name,
+    int act = ACT_NONE,
+    int act_param = 0,
+    int frames = 1,
+    bool extreme = false,
+    int shift_add = 0
+) {
+    const int OH = H - KS + 1;
+    const int OW = W - KS + 1;
+    typedef acc_width<P::A_W + P::W_W, P::B_W, KS * KS * C_IN> ACC;
 
-    //比较
-    bool pass = true;
-    for (int y = 0; y < OUT_H; y++) {
-        for (int x = 0; x < OUT_W; x++) {
-            axis_t out = out_stream.read();
-            data_t dut_val = (data_t)out.data;
-
-            if (dut_val != golden_out[y][x]) {
-                std::cout << "Mismatch @("
-                          << y << "," << x << ") "
-                          << "DUT=" << dut_val
-                          << " Golden=" << golden_out[y][x]
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > in_stream;
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > out_stream;
+
+    static prec_case<H, W, C_IN, C_OUT, KS, P> tc;
+    static ap_int<P::O_W> golden_out[OH][OW][C_OUT];
+    static ap_int<P::O_W> dut_out[OH][OW][C_OUT];
+
+    for (int f = 0; f < frames; f++) {
+        tc.init(f, extreme, shift_add);
+        pack_frame<BUS_W, H, W, C_IN>(tc.input, in_stream);
+    }
+
+    conv_prec_axis<H, W, C_IN, C_OUT, KS, P, BUS_W>(
+        in_stream, out_stream, tc.wbus, tc.bias, tc.qmul, tc.qshift,
+        act, act_param, frames, H, W, C_IN);
+
+    for (int f = 0; f < frames; f++) {
+        tc.init(f, extreme, shift_add);
+        tc.golden(golden_out, act, act_param);
+
+        if (!unpack_frame<BUS_W, OH, OW, C_OUT>(out_stream, dut_out)) {
+            std::cout << name << " stream format error @frame " << f << std::endl;
+            return false;
+        }
+        if (!compare_maps<OH, OW, C_OUT>(name, dut_out, golden_out))
+            return false;
+    }
+
+    if (!in_stream.empty() || !out_stream.empty()) {
+        std::cout << name << " stream not drained" << std::endl;
+        return false;
+    }
+
+    std::cout << name << " passed (sum " << ACC::SUM_W << " bits, acc "
+              << ACC::ACC_W << " bits)" << std::endl;
+    return true;
+}
+
+/*
+ * 文件回放: 输入、权重与量化参数从映射的文件读取, 每个像素直接从映射区
+ * 写入 in_stream, DUT 输出逐像素写入映射的输出 .npy, 不复制整帧.
+ * 输入 int8 (N, rows, cols, chans), 权重 int8 (C_OUT, KS, KS, chans),
+ * 量化参数 int32 (C_OUT, 3) 每行为 [bias, qmul, qshift], chans <= C_IN,
+ * 其余通道补 0. 输出 int8 (N, rows-KS+1, cols-KS+1, C_OUT).
+ * 每次调用 DUT 送入 chunk 帧, 流中最多缓存 chunk 帧.
+ */
+template<int H, int W, int C_IN, int C_OUT, int KS, int BUS_W>
+bool replay_files(
+    const char *name,
+    void (*dut)(hls::stream<ap_axis<BUS_W, 0, 0, 0> > &,
+                hls::stream<ap_axis<BUS_W, 0, 0, 0> > &,
+                const wbus_t *, bias_t [C_OUT],
+                qmul_t [C_OUT], qshift_t [C_OUT], act_t, ap_uint<8>,
+                ap_uint<32>, dim_t, dim_t, dim_t),
+    tensor_file &in,
+    tensor_file &w,
+    tensor_file &q,
+    const char *out_path,
+    int act,
+    int act_param,
+    int chunk
+) {
+    const int WEIGHTS = C_OUT * KS * KS * C_IN;
+    const std::vector<long> &s = in.shape();
+
+    if (s.size() != 4 || in.elem_size() != 1 || s[1] < KS || s[1] > H ||
+        s[2] < KS || s[2] > W || s[3] < 1 || s[3] > C_IN) {
+        std::cout << name << ": input must be int8 (N, rows, cols, chans) within "
+                  << H << "x" << W << "x" << C_IN << std::endl;
+        return false;
+    }
+    int frames = s[0];
+    int rows = s[1];
+    int cols = s[2];
+    int chans = s[3];
+    int oh = rows - KS + 1;
+    int ow = cols - KS + 1;
+
+    const std::vector<long> &ws = w.shape();
+    if (ws.size() != 4 || w.elem_size() != 1 || ws[0] != C_OUT ||
+        ws[1] != KS || ws[2] != KS || ws[3] != chans) {
+        std::cout << name << ": weights must be int8 (" << C_OUT << ", " << KS
+                  << ", " << KS << ", " << chans << ")" << std::endl;
+        return false;
+    }
+    if (q.shape().size() != 2 || q.elem_size() != 4 || q.shape()[0] != C_OUT ||
+        q.shape()[1] != 3) {
+        std::cout << name << ": quant must be int32 (" << C_OUT << ", 3)"
+                  << std::endl;
+        return false;
+    }
+
+    std::vector<data_t> weight(WEIGHTS, 0);
+    const int8_t *wsrc = w.data<int8_t>();
+    for (int i = 0; i < C_OUT * KS * KS; i++)
+        for (int c = 0; c < chans; c++)
+            weight[i * C_IN + c] = wsrc[i * chans + c];
+    static wbus_t wbus[(WEIGHTS * DATA_W + WBUS_W - 1) / WBUS_W];
+    pack_weights<WEIGHTS>(&weight[0], wbus);
+
+    bias_t bias[C_OUT];
+    qmul_t qmul[C_OUT];
+    qshift_t qshift[C_OUT];
+    const int32_t *qsrc = q.data<int32_t>();
+    for (int co = 0; co < C_OUT; co++) {
+        bias[co] = qsrc[co * 3];
+        qmul[co] = qsrc[co * 3 + 1];
+        qshift[co] = qsrc[co * 3 + 2];
+    }
+
+    tensor_file out;
+    std::vector<long> os(4);
+    os[0] = frames;
+    os[1] = oh;
+    os[2] = ow;
+    os[3] = C_OUT;
+    if (!out.create_npy(out_path, "|i1", os)) {
+        std::cout << name << ": " << out_path << ": " << out.error() << std::endl;
+        return false;
+    }
+
+    const int8_t *src = in.data<int8_t>();
+    int8_t *dst = out.data<int8_t>();
+    double ms = 0;
+
+    for (int f0 = 0; f0 < frames; f0 += chunk) {
+        int n = (frames - f0 < chunk) ? frames - f0 : chunk;
+        hls::stream<ap_axis<BUS_W, 0, 0, 0> > in_stream;
+        hls::stream<ap_axis<BUS_W, 0, 0, 0> > out_stream;
+
+        axis_pixel_writer<BUS_W, C_IN> writer(in_stream, rows * cols);
+        int8_t pix[C_IN] = {0};
+        for (long p = (long)f0 * rows * cols; p < (long)(f0 + n) * rows * cols; p++) {
+            for (int c = 0; c < chans; c++)
+                pix[c] = src[p * chans + c];
+            writer.write(pix);
+        }
+
+        double t0 = wall_ms();
+        dut(in_stream, out_stream, wbus, bias, qmul, qshift, act, act_param,
+            n, rows, cols, chans);
+        ms += wall_ms() - t0;
+
+        //输出像素的 C_OUT 个通道连续存放, 直接读入映射区
+        axis_pixel_reader<BUS_W, C_OUT> reader(out_stream, oh * ow);
+        for (long p = (long)f0 * oh * ow; p < (long)(f0 + n) * oh * ow; p++) {
+            if (!reader.read(dst + p * C_OUT))
+                return false;
+        }
+        if (!in_stream.empty() || !out_stream.empty()) {
+            std::cout << name << " stream not drained" << std::endl;
+            return false;
+        }
+    }
+
+    report_pass(name, ms, (long long)frames * rows * cols);
+    return true;
+}
+
+/*
+ * 回放测试的临时文件名: $TMPDIR/tb_replay_<进程号>_<用例名>_*, 并行或
+ * 重复运行的测试互不覆盖. 析构时删除, 任何返回路径都不留下文件.
+ */
+struct replay_tmp_paths {
+    std::string in;
+    std::string w;
+    std::string q;
+    std::string out;
+
+    replay_tmp_paths(const char *name, bool raw) {
+        const char *tmp = getenv("TMPDIR");
+        std::string base = tmp ? tmp : "/tmp";
+        base += "/tb_replay_" + std::to_string((long)tb_getpid()) + "_";
+        for (const char *p = name; *p; p++) {
+            char c = *p;
+            bool keep = (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+                        (c >= 'A' && c <= 'Z');
+            base += keep ? c : '_';
+        }
+        in = base + (raw ? "_in.raw" : "_in.npy");
+        w = base + "_w.npy";
+        q = base + "_q.npy";
+        out = base + "_out.npy";
+    }
+
+    ~replay_tmp_paths() {
+        remove(in.c_str());
+        remove(w.c_str());
+        remove(q.c_str());
+        remove(out.c_str());
+    }
+};
+
+/*
+ * 文件回放测试: 随机生成输入、权重与量化参数写入临时文件 (输入为 .npy
+ * 或原始数据), 回放后映射输出文件, 与 host_conv 的结果比较
+ */
+template<int H, int W, int C_IN, int C_OUT, int KS, int BUS_W>
+bool run_file_case(
+    const char *name,
+    void (*dut)(hls::stream<ap_axis<BUS_W, 0, 0, 0> > &,
+                hls::stream<ap_axis<BUS_W, 0, 0, 0> > &,
+                const wbus_t *, bias_t [C_OUT],
+                qmul_t [C_OUT], qshift_t [C_OUT], act_t, ap_uint<8>,
+                ap_uint<32>, dim_t, dim_t, dim_t),
+    int frames,
+    int rows,
+    int cols,
+    int chans,
+    int chunk,
+    bool raw,
+    int act = ACT_NONE,
+    int act_param = 0
+) {
+    replay_tmp_paths paths(name, raw);
+    const std::string &in_path = paths.in;
+    const std::string &w_path = paths.w;
+    const std::string &q_path = paths.q;
+    const std::string &out_path = paths.out;
+    int oh = rows - KS + 1;
+    int ow = cols - KS + 1;
+    test_rng rng(frames * 131u + rows * 17u + cols);
+
+    std::vector<long> is(4);
+    is[0] = frames;
+    is[1] = rows;
+    is[2] = cols;
+    is[3] = chans;
+    std::vector<long> ws(4);
+    ws[0] = C_OUT;
+    ws[1] = KS;
+    ws[2] = KS;
+    ws[3] = chans;
+    std::vector<long> qs(2);
+    qs[0] = C_OUT;
+    qs[1] = 3;
+
+    //参考模型使用全部 C_IN 个通道, chans 之后的输入与权重为 0
+    std::vector<int8_t> in_ref(frames * rows * cols * C_IN, 0);
+    std::vector<int8_t> w_ref(C_OUT * KS * KS * C_IN, 0);
+    std::vector<int32_t> b32(C_OUT);
+    std::vector<uint16_t> m16(C_OUT);
+    std::vector<uint8_t> s8(C_OUT);
+    std::vector<int8_t> body((long)frames * rows * cols * chans);
+    for (long p = 0; p < (long)frames * rows * cols; p++) {
+        for (int c = 0; c < chans; c++) {
+            body[p * chans + c] = rng.range(-128, 127);
+            in_ref[p * C_IN + c] = body[p * chans + c];
+        }
+    }
+    if (raw) {
+        FILE *f = fopen(in_path.c_str(), "wb");
+        bool wr = f && fwrite(&body[0], 1, body.size(), f) == body.size();
+        if (f)
+            fclose(f);
+        if (!wr) {
+            std::cout << name << ": cannot write raw input" << std::endl;
+            return false;
+        }
+    }
+    {
+        tensor_file fi;
+        tensor_file fw;
+        tensor_file fq;
+        if ((!raw && !fi.create_npy(in_path.c_str(), "|i1", is)) ||
+            !fw.create_npy(w_path.c_str(), "|i1", ws) ||
+            !fq.create_npy(q_path.c_str(), "<i4", qs)) {
+            std::cout << name << ": cannot create test files" << std::endl;
+            return false;
+        }
+        if (!raw)
+            memcpy(fi.data<int8_t>(), &body[0], body.size());
+        int8_t *pw = fw.data<int8_t>();
+        for (int i = 0; i < C_OUT * KS * KS; i++) {
+            for (int c = 0; c < chans; c++) {
+                pw[i * chans + c] = rng.range(-128, 127);
+                w_ref[i * C_IN + c] = pw[i * chans + c];
+            }
+        }
+        int32_t *pq = fq.data<int32_t>();
+        for (int co = 0; co < C_OUT; co++) {
+            pq[co * 3] = b32[co] = rng.range(-100000, 100000);
+            pq[co * 3 + 1] = m16[co] = rng.range(1, 65535);
+            pq[co * 3 + 2] = s8[co] = rng.range(14, 26);
+        }
+    }
+
+    bool ok;
+    {
+        tensor_file in;
+        tensor_file w;
+        tensor_file q;
+        ok = raw ? in.open_raw(in_path.c_str(), is, 1)
+                 : in.open_npy(in_path.c_str());
+        ok = ok && w.open_npy(w_path.c_str()) && q.open_npy(q_path.c_str());
+        if (!ok) {
+            std::cout << name << ": cannot open test files" << std::endl;
+            return false;
+        }
+        ok = replay_files<H, W, C_IN, C_OUT, KS, BUS_W>(name, dut, in, w, q,
+                out_path.c_str(), act, act_param, chunk);
+    }
+
+    if (ok) {
+        host_conv_layer l = {rows, cols, C_IN, C_OUT, KS, &w_ref[0], &b32[0],
+                             &m16[0], &s8[0], act, act_param};
+        std::vector<int8_t> ref(frames * oh * ow * C_OUT);
+        host_conv(l, &in_ref[0], &ref[0], frames, host_detect_isa());
+
+        tensor_file out;
+        ok = out.open_npy(out_path.c_str()) && out.count() == (long)ref.size() &&
+             out.shape()[1] == oh && out.shape()[2] == ow;
+        if (!ok)
+            std::cout << name << ": bad output file" << std::endl;
+        for (long i = 0; ok && i < out.count(); i++) {
+            if (out.data<int8_t>()[i] != ref[i]) {
+                std::cout << name << " Mismatch @" << i << " DUT="
+                          << (int)out.data<int8_t>()[i] << " Ref="
+                          << (int)ref[i] << std::endl;
+                ok = false;
+            }
+        }
+    }
+    return ok;
+}
+
+//C 仿真后端使用的权重与输出级参数
+template<int C_OUT>
+struct csim_weights {
+    std::vector<wbus_t> wbus;
+    bias_t bias[C_OUT];
+    qmul_t qmul[C_OUT];
+    qshift_t qshift[C_OUT];
+    int act;
+    int act_param;
+};
+
+/*
+ * 推理运行时的 C 仿真后端: 一批帧从各缓冲逐像素写入输入流, 调用一次
+ * DUT (frames 为批大小), 输出逐像素读回各缓冲. 缓冲为 H x W x C_IN 与
+ * (H-KS+1) x (W-KS+1) x C_OUT 的 NHWC int8.
+ */
+template<int H, int W, int C_IN, int C_OUT, int KS, int BUS_W>
+class csim_backend : public infer_backend<csim_weights<C_OUT> > {
+public:
+    typedef void (*dut_fn)(hls::stream<ap_axis<BUS_W, 0, 0, 0> > &,
+                           hls::stream<ap_axis<BUS_W, 0, 0, 0> > &,
+                           const wbus_t *, bias_t [C_OUT],
+                           qmul_t [C_OUT], qshift_t [C_OUT], act_t,
+                           ap_uint<8>, ap_uint<32>, dim_t, dim_t, dim_t);
+
+    explicit csim_backend(dut_fn dut) : dut_(dut) {}
+
+    bool run(frame_buffer *const *bufs, int n, const csim_weights<C_OUT> &w) {
+        const int OH = H - KS + 1;
+        const int OW = W - KS + 1;
+        hls::stream<ap_axis<BUS_W, 0, 0, 0> > in_stream;
+        hls::stream<ap_axis<BUS_W, 0, 0, 0> > out_stream;
+
+        axis_pixel_writer<BUS_W, C_IN> writer(in_stream, H * W);
+        for (int f = 0; f < n; f++) {
+            for (int p = 0; p < H * W; p++)
+                writer.write(bufs[f]->in + p * C_IN);
+        }
+
+        bias_t bias[C_OUT];
+        qmul_t qmul[C_OUT];
+        qshift_t qshift[C_OUT];
+        for (int co = 0; co < C_OUT; co++) {
+            bias[co] = w.bias[co];
+            qmul[co] = w.qmul[co];
+            qshift[co] = w.qshift[co];
+        }
+        dut_(in_stream, out_stream, &w.wbus[0], bias, qmul, qshift, w.act,
+             w.act_param, n, H, W, C_IN);
+
+        axis_pixel_reader<BUS_W, C_OUT> reader(out_stream, OH * OW);
+        for (int f = 0; f < n; f++) {
+            for (int p = 0; p < OH * OW; p++) {
+                if (!reader.read(bufs[f]->out + p * C_OUT))
+                    return false;
+            }
+        }
+        return in_stream.empty() && out_stream.empty();
+    }
+
+private:
+    dut_fn dut_;
+};
+
+/*
+ * 运行时测试与吞吐率: 主机预处理 (8 位图像减 128 转为 int8, 再做一次
+ * 3x3 平滑) 与后端执行先串行再经运行时流水, 比较两者的帧率.
+ * 输出逐帧与 host_conv 比较, 输入由帧号重新生成.
+ */
+template<int H, int W, int C_IN, int C_OUT, int KS, int BUS_W>
+bool run_runtime_case(
+    const char *name,
+    typename csim_backend<H, W, C_IN, C_OUT, KS, BUS_W>::dut_fn dut,
+    int frames,
+    int buffers,
+    int max_batch,
+    int act = ACT_NONE,
+    int act_param = 0
+) {
+    const int OH = H - KS + 1;
+    const int OW = W - KS + 1;
+    const int IN_N = H * W * C_IN;
+    const int OUT_N = OH * OW * C_OUT;
+    const int WEIGHTS = C_OUT * KS * KS * C_IN;
+    test_rng rng(frames * 7u + buffers);
+
+    csim_weights<C_OUT> cw;
+    std::vector<data_t> weight(WEIGHTS);
+    std::vector<int8_t> w8(WEIGHTS);
+    std::vector<int32_t> b32(C_OUT);
+    std::vector<uint16_t> m16(C_OUT);
+    std::vector<uint8_t> s8(C_OUT);
+    for (int i = 0; i < WEIGHTS; i++)
+        weight[i] = w8[i] = rng.range(-128, 127);
+    cw.wbus.resize((WEIGHTS * DATA_W + WBUS_W - 1) / WBUS_W);
+    pack_weights<WEIGHTS>(&weight[0], &cw.wbus[0]);
+    for (int co = 0; co < C_OUT; co++) {
+        cw.bias[co] = b32[co] = rng.range(-100000, 100000);
+        cw.qmul[co] = m16[co] = rng.range(1, 65535);
+        cw.qshift[co] = s8[co] = rng.range(14, 26);
+    }
+    cw.act = act;
+    cw.act_param = act_param;
+
+    //主机预处理: 由帧号生成 8 位图像, 平滑后减 128
+    struct pre {
+        static void run(int f, int8_t *dst) {
+            static uint8_t img[H][W][C_IN];
+            test_rng r(f + 1u);
+            for (int i = 0; i < IN_N; i++)
+                (&img[0][0][0])[i] = r.range(0, 255);
+            for (int y = 0; y < H; y++) {
+                for (int x = 0; x < W; x++) {
+                    for (int c = 0; c < C_IN; c++) {
+                        int sum = 0;
+                        int cnt = 0;
+                        for (int dy = -1; dy <= 1; dy++) {
+                            for (int dx = -1; dx <= 1; dx++) {
+                                if (y + dy < 0 || y + dy >= H ||
+                                    x + dx < 0 || x + dx >= W)
+                                    continue;
+                                sum += img[y + dy][x + dx][c];
+                                cnt++;
+                            }
+                        }
+                        dst[(y * W + x) * C_IN + c] = sum / cnt - 128;
+                    }
+                }
+            }
+        }
+    };
+
+    csim_backend<H, W, C_IN, C_OUT, KS, BUS_W> backend(dut);
+    std::vector<int8_t> out(frames * OUT_N);
+
+    //串行: 预处理一帧, 等它执行完再处理下一帧
+    double t0 = wall_ms();
+    {
+        std::vector<int8_t> in(IN_N);
+        frame_buffer fb;
+        frame_buffer *fp = &fb;
+        fb.in = &in[0];
+        for (int f = 0; f < frames; f++) {
+            pre::run(f, fb.in);
+            fb.out = &out[f * OUT_N];
+            if (!backend.run(&fp, 1, cw)) {
+                std::cout << name << " serial run failed @frame " << f
                           << std::endl;
-                pass = false;
-                goto END;
+                return false;
+            }
+        }
+    }
+    double serial_ms = wall_ms() - t0;
+
+    //流水: 最多 buffers 帧在途, 完成的帧按提交顺序取回
+    std::vector<int8_t> piped(frames * OUT_N);
+    long long batches;
+    bool ok = true;
+    t0 = wall_ms();
+    {
+        infer_runtime<csim_weights<C_OUT> > rt(backend, buffers, IN_N, OUT_N,
+                                               max_batch);
+        std::deque<std::future<frame_buffer *> > pending;
+        int next = 0;
+        for (int f = 0; f < frames || !pending.empty(); ) {
+            if (f < frames && (int)pending.size() < buffers) {
+                frame_buffer *buf = rt.acquire();
+                pre::run(f, buf->in);
+                pending.push_back(rt.submit(buf, cw));
+                f++;
+                continue;
+            }
+            frame_buffer *buf = pending.front().get();
+            pending.pop_front();
+            ok = ok && buf->ok;
+            memcpy(&piped[next * OUT_N], buf->out, OUT_N);
+            next++;
+            rt.release(buf);
+        }
+        rt.wait_idle();
+        batches = rt.batches();
+    }
+    double piped_ms = wall_ms() - t0;
+    if (!ok) {
+        std::cout << name << " backend failed" << std::endl;
+        return false;
+    }
+
+    host_conv_layer l = {H, W, C_IN, C_OUT, KS, &w8[0], &b32[0], &m16[0],
+                         &s8[0], act, act_param};
+    std::vector<int8_t> in(IN_N);
+    std::vector<int8_t> ref(OUT_N);
+    for (int f = 0; f < frames; f++) {
+        pre::run(f, &in[0]);
+        host_conv(l, &in[0], &ref[0], 1, host_detect_isa());
+        for (int i = 0; i < OUT_N; i++) {
+            if (out[f * OUT_N + i] != ref[i] || piped[f * OUT_N + i] != ref[i]) {
+                std::cout << name << " Mismatch @frame " << f << " " << i
+                          << " serial=" << (int)out[f * OUT_N + i]
+                          << " runtime=" << (int)piped[f * OUT_N + i]
+                          << " Ref=" << (int)ref[i] << std::endl;
+                return false;
+            }
+        }
+    }
+
+    std::cout << name << ": serial " << frames * 1000.0 / serial_ms
+              << " frames/s, runtime " << frames * 1000.0 / piped_ms
+              << " frames/s (" << serial_ms / piped_ms << "x, "
+              << (double)frames / batches << " frames per batch)" << std::endl;
+    std::cout << name << " passed" << std::endl;
+    return true;
+}
+
+//GEMM 权重 w[n][kd] 按 [n 块][k][j] 排列后打包, 最后一块不足 PC 列补 0
+template<int PC>
+void pack_gemm_weights(const int8_t *w, int kd, int n, std::vector<wbus_t> &dst) {
+    const int LANES = WBUS_W / DATA_W;
+    int nt = (n + PC - 1) / PC;
+    int total = nt * kd * PC;
+
+    dst.assign((total + LANES - 1) / LANES, 0);
+    for (int e = 0; e < total; e++) {
+        int nb = e / (kd * PC);
+        int k = e / PC % kd;
+        int c = nb * PC + e % PC;
+        int v = (c < n) ? w[c * kd + k] : 0;
+        dst[e / LANES].range(e % LANES * DATA_W + DATA_W - 1,
+                             e % LANES * DATA_W) = (ap_uint<DATA_W>)v;
+    }
+}
+
+/*
+ * GEMM 测试与吞吐率: 随机 A / 权重 / 量化参数, 与 golden_gemm 逐位比较.
+ * 按阵列时序估算周期数 (每块 kd+PR+PC-2 拍, 最后再输出 PR 拍), 给出每拍
+ * 乘加次数与 PE 利用率, 以及 C 仿真与参考模型的耗时.
+ * edge 时各列偏置轮流取 int32 最大值 / 最小值 / 随机值, 检查偏置相加
+ * 不回绕.
+ */
+template<int PR, int PC, int KMAX, int NMAX, int BUS_W>
+bool run_gemm_case(
+    const char *name,
+    void (*dut)(hls::stream<ap_axis<BUS_W, 0, 0, 0> > &,
+                hls::stream<ap_axis<BUS_W, 0, 0, 0> > &,
+                const wbus_t *, bias_t [NMAX],
+                qmul_t [NMAX], qshift_t [NMAX], act_t, ap_uint<8>,
+                ap_uint<32>, dim_t, dim_t),
+    int m,
+    int kd,
+    int n,
+    int act = ACT_NONE,
+    int act_param = 0,
+    bool edge = false
+) {
+    const int LANES = BUS_W / DATA_W;
+    test_rng rng(m * 131u + kd * 17u + n);
+
+    std::vector<int8_t> a(m * kd);
+    std::vector<int8_t> w(n * kd);
+    std::vector<int32_t> b32(n);
+    std::vector<uint16_t> m16(n);
+    std::vector<uint8_t> s8(n);
+    for (size_t i = 0; i < a.size(); i++)
+        a[i] = rng.range(-128, 127);
+    for (size_t i = 0; i < w.size(); i++)
+        w[i] = rng.range(-128, 127);
+
+    bias_t bias[NMAX];
+    qmul_t qmul[NMAX];
+    qshift_t qshift[NMAX];
+    for (int c = 0; c < NMAX; c++) {
+        bias[c] = 0;
+        qmul[c] = 0;
+        qshift[c] = 0;
+    }
+    for (int c = 0; c < n; c++) {
+        b32[c] = rng.range(-100000, 100000);
+        if (edge && c % 3 != 2)
+            b32[c] = (c % 3 == 0) ? 2147483647 : -2147483647 - 1;
+        bias[c] = b32[c];
+        qmul[c] = m16[c] = rng.range(1, 65535);
+        qshift[c] = s8[c] = rng.range(14, 24);
+    }
+    std::vector<wbus_t> wbus;
+    pack_gemm_weights<PC>(&w[0], kd, n, wbus);
+
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > in_stream;
+    hls::stream<ap_axis<BUS_W, 0, 0, 0> > out_stream;
+
+    //A 每行从新的一拍开始
+    int in_beats = (kd + LANES - 1) / LANES;
+    for (int r = 0; r < m; r++) {
+        for (int b = 0; b < in_beats; b++) {
+            ap_axis<BUS_W, 0, 0, 0> beat;
+            beat.data = 0;
+            beat.keep = 0;
+            for (int l = 0; l < LANES && b * LANES + l < kd; l++) {
+                beat.data.range(l * DATA_W + DATA_W - 1, l * DATA_W) =
+                    (ap_uint<DATA_W>)a[r * kd + b * LANES + l];
+                beat.keep[l] = 1;
+            }
+            beat.last = (r == m - 1 && b == in_beats - 1);
+            in_stream.write(beat);
+        }
+    }
+
+    double t0 = wall_ms();
+    dut(in_stream, out_stream, &wbus[0], bias, qmul, qshift, act, act_param,
+        m, kd, n);
+    double ms = wall_ms() - t0;
+
+    std::vector<int8_t> ref(m * n);
+    t0 = wall_ms();
+    golden_gemm(&a[0], &w[0], &b32[0], &m16[0], &s8[0], act, act_param,
+                m, kd, n, &ref[0]);
+    double golden_ms = wall_ms() - t0;
+
+    int out_beats = (n + LANES - 1) / LANES;
+    for (int r = 0; r < m; r++) {
+        for (int b = 0; b < out_beats; b++) {
+            if (out_stream.empty()) {
+                std::cout << name << " output too short @row " << r << std::endl;
+                return false;
+            }
+            ap_axis<BUS_W, 0, 0, 0> beat = out_stream.read();
+            if ((bool)beat.last != (r == m - 1 && b == out_beats - 1)) {
+                std::cout << name << " TLAST error @row " << r << std::endl;
+                return false;
+            }
+            for (int l = 0; l < LANES && b * LANES + l < n; l++) {
+                int c = b * LANES + l;
+                int v = (int8_t)beat.data.range(l * DATA_W + DATA_W - 1,
+                                                l * DATA_W).to_int();
+                if (!beat.keep[l] || v != ref[r * n + c]) {
+                    std::cout << name << " Mismatch @(" << r << "," << c
+                              << ") DUT=" << v << " Golden="
+                              << (int)ref[r * n + c] << std::endl;
+                    return false;
+                }
             }
         }
     }
+    if (!in_stream.empty() || !out_stream.empty()) {
+        std::cout << name << " stream not drained" << std::endl;
+        return false;
+    }
+
+    long long tiles = (long long)((m + PR - 1) / PR) * ((n + PC - 1) / PC);
+    long long cycles = tiles * (kd + PR + PC - 2) + PR;
+    double macs = (double)m * kd * n;
+    std::cout << name << ": " << PR << "x" << PC << " PEs, " << cycles
+              << " array cycles, " << macs / cycles << " MAC/cycle ("
+              << 100.0 * macs / cycles / (PR * PC) << "% PE use), golden "
+              << golden_ms << " ms" << std::endl;
+    report_pass(name, ms, (long long)m * kd);
+    return true;
+}
+
+//调用顶层, 带性能计数器时打印计数
+void cnn_conv_layer_top(
+    hls::stream<axis_t> &in_stream,
+    hls::stream<axis_t> &out_stream,
+    const wbus_t *weight,
+    bias_t bias[OUT_C],
+    qmul_t qmul[OUT_C],
+    qshift_t qshift[OUT_C],
+    act_t act,
+    ap_uint<8> act_param,
+    ap_uint<32> frames,
+    dim_t rows,
+    dim_t cols,
+    dim_t chans,
+    stride_t stride,
+    dim_t pad
+) {
+#if CONV_PERF
+    axis_perf perf_in;
+    axis_perf perf_out;
+    cnn_conv_layer(in_stream, out_stream, weight, bias, qmul, qshift,
+                   act, act_param, frames, rows, cols, chans, stride, pad,
+                   perf_in, perf_out);
+    print_perf("top perf", perf_in, perf_out);
+#else
+    cnn_conv_layer(in_stream, out_stream, weight, bias, qmul, qshift,
+                   act, act_param, frames, rows, cols, chans, stride, pad);
+#endif
+}
+
+//顶层按 valid、步长 1 运行, 接口与 conv_axis 相同
+void cnn_conv_layer_valid(
+    hls::stream<axis_t> &in_stream,
+    hls::stream<axis_t> &out_stream,
+    const wbus_t *weight,
+    bias_t bias[OUT_C],
+    qmul_t qmul[OUT_C],
+    qshift_t qshift[OUT_C],
+    act_t act,
+    ap_uint<8> act_param,
+    ap_uint<32> frames,
+    dim_t rows,
+    dim_t cols,
+    dim_t chans
+) {
+    cnn_conv_layer_top(in_stream, out_stream, weight, bias, qmul, qshift,
+                       act, act_param, frames, rows, cols, chans, 1, 0);
+}
+
+/*
+ * 回放文件: tb replay 输入 权重 量化参数 输出 [激活 [激活参数]]
+ * 输入为 .npy, 或顶层尺寸 IN_H x IN_W x IN_C 的连续 int8 原始帧
+ */
+int replay_main(int argc, char **argv) {
+    if (argc < 6) {
+        std::cout << "usage: " << argv[0]
+                  << " replay in.npy|in.raw weight.npy quant.npy out.npy"
+                     " [act [act_param]]" << std::endl;
+        return 2;
+    }
+    std::string in_path = argv[2];
+    bool npy = in_path.size() > 4 &&
+               in_path.compare(in_path.size() - 4, 4, ".npy") == 0;
+
+    tensor_file in;
+    tensor_file w;
+    tensor_file q;
+    bool ok;
+    if (npy) {
+        ok = in.open_npy(argv[2]);
+    }
+    else {
+        //原始帧数由文件大小得到
+        FILE *f = fopen(argv[2], "rb");
+        long size = 0;
+        if (f) {
+            fseek(f, 0, SEEK_END);
+            size = ftell(f);
+            fclose(f);
+        }
+        std::vector<long> s(4);
+        s[0] = size / (IN_H * IN_W * IN_C);
+        s[1] = IN_H;
+        s[2] = IN_W;
+        s[3] = IN_C;
+        ok = in.open_raw(argv[2], s, 1);
+    }
+    if (!ok) {
+        std::cout << argv[2] << ": " << in.error() << std::endl;
+        return 1;
+    }
+    if (!w.open_npy(argv[3])) {
+        std::cout << argv[3] << ": " << w.error() << std::endl;
+        return 1;
+    }
+    if (!q.open_npy(argv[4])) {
+        std::cout << argv[4] << ": " << q.error() << std::endl;
+        return 1;
+    }
+
+    int act = (argc > 6) ? atoi(argv[6]) : ACT_NONE;
+    int act_param = (argc > 7) ? atoi(argv[7]) : 0;
+    ok = replay_files<IN_H, IN_W, IN_C, OUT_C, K, AXIS_W>("replay",
+            cnn_conv_layer_valid, in, w, q, argv[5], act, act_param, 8);
+    return ok ? 0 : 1;
+}
+
+/*
+ * 用法: tb [种子 [随机迭代次数]], 或 tb replay ... (见 replay_main)
+ * 种子缺省为 1, 每次运行结果相同; 任一测试失败时返回 1.
+ */
+int main(int argc, char **argv) {
+    if (argc > 1 && std::string(argv[1]) == "replay")
+        return replay_main(argc, argv);
+
+    unsigned seed = (argc > 1) ? (unsigned)strtoul(argv[1], 0, 0) : 1;
+    int iters = (argc > 2) ? atoi(argv[2]) : 8;
+    double t_start = wall_ms();
+
+    std::cout << "random seed " << seed << ", " << iters << " iterations"
+              << std::endl;
+
+    bool pass = true;
+
+    //顶层配置
+    pass &= run_case<IN_H, IN_W, IN_C, OUT_C, K, AXIS_W>("top",
+                                                         cnn_conv_layer_valid);
+
+    //同一次编译中实例化其它尺寸与总线宽度
+    pass &= run_case<8, 8, 1, 1, 3, 8>("8x8x1->1 k3 bus8",
+                                       conv_axis<8, 8, 1, 1, 3, 8>);
+    pass &= run_case<IN_H, IN_W, IN_C, OUT_C, K, 8>("top shape bus8",
+                                       conv_axis<IN_H, IN_W, IN_C, OUT_C, K, 8>);
+    pass &= run_case<12, 10, 4, 8, 5, 64>("12x10x4->8 k5 bus64 relu",
+                                          conv_axis<12, 10, 4, 8, 5, 64>,
+                                          ACT_RELU);
+    pass &= run_case<6, 7, 2, 3, 1, 64>("6x7x2->3 k1 bus64 relu6",
+                                        conv_axis<6, 7, 2, 3, 1, 64>,
+                                        ACT_RELU6, 40);
+    pass &= run_case<9, 9, 3, 5, 3, 16>("9x9x3->5 k3 bus16 leaky",
+                                        conv_axis<9, 9, 3, 5, 3, 16>,
+                                        ACT_LEAKY, 26);
+    pass &= run_case<12, 224, 3, 4, 3, 32>("12x224x3->4 k3 bus32",
+                                           conv_axis<12, 224, 3, 4, 3, 32>);
+
+    //同一实例连续运行两帧, 检查行缓冲轮转后的状态
+    pass &= run_case<9, 9, 3, 5, 3, 16>("9x9x3->5 k3 bus16 again",
+                                        conv_axis<9, 9, 3, 5, 3, 16>);
+
+    //卷积+池化
+    pass &= run_pool_case<IN_H, IN_W, IN_C, OUT_C, K, POOL_K, POOL_S, AXIS_W>(
+        "top conv+maxpool", cnn_conv_pool_layer, POOL_MAX, ACT_RELU);
+    pass &= run_pool_case<IN_H, IN_W, IN_C, OUT_C, K, POOL_K, POOL_S, AXIS_W>(
+        "top conv+avgpool", cnn_conv_pool_layer, POOL_AVG);
+    pass &= run_pool_case<13, 15, 2, 3, 3, 3, 2, 32>(
+        "13x15x2->3 k3 maxpool3 s2",
+        conv_pool_axis<13, 15, 2, 3, 3, 3, 2, 32>, POOL_MAX);
+    pass &= run_pool_case<13, 15, 2, 3, 3, 3, 1, 32>(
+        "13x15x2->3 k3 avgpool3 s1",
+        conv_pool_axis<13, 15, 2, 3, 3, 3, 1, 32>, POOL_AVG, ACT_LEAKY, 64);
+
+    //多层级联
+    pass &= run_chain_case<net_l1, net_l2, net_l3, AXIS_W>("top net",
+                                                           cnn_net);
+    {
+        typedef conv_shape<10, 11, 2, 3, 3> c1;
+        typedef conv_shape<8, 9, 3, 5, 1> c2;
+        typedef conv_shape<8, 9, 5, 2, 3> c3;
+        pass &= run_chain_case<c1, c2, c3, 64>("net 10x11x2 k3/k1/k3 bus64",
+                                               conv_chain3<c1, c2, c3, 64>);
+    }
+    {
+        typedef conv_shape<9, 10, 3, 4, 3> c1;
+        typedef conv_shape<7, 8, 4, 2, 3> c2;
+        pass &= run_chain2_case<c1, c2, 32>("net 9x10x3 k3/k3 two layers",
+                                            conv_chain2<c1, c2, 32>);
+    }
+
+    //批处理: 按帧数, 或一直处理到输入 TLAST
+    pass &= run_case<9, 9, 3, 5, 3, 16>("9x9x3->5 k3 bus16 4 frames",
+                                        conv_axis<9, 9, 3, 5, 3, 16>,
+                                        ACT_NONE, 0, 4);
+    pass &= run_case<IN_H, IN_W, IN_C, OUT_C, K, AXIS_W>("top 3 frames tlast",
+                                        cnn_conv_layer_valid, ACT_RELU, 0, 3, true);
+    pass &= run_pool_case<13, 15, 2, 3, 3, 3, 2, 32>(
+        "13x15x2->3 k3 maxpool3 s2 3 frames tlast",
+        conv_pool_axis<13, 15, 2, 3, 3, 3, 2, 32>, POOL_MAX,
+        ACT_NONE, 0, 3, true);
+    pass &= run_pool_case<12, 12, 2, 3, 3, 3, 3, 16>(
+        "12x12x2->3 k3 avgpool3 s3 2 frames",
+        conv_pool_axis<12, 12, 2, 3, 3, 3, 3, 16>, POOL_AVG,
+        ACT_NONE, 0, 2);
+
+    //运行时尺寸: 以较大的上限实例化, 按寄存器给出的实际尺寸运行
+    pass &= run_case<10, 12, IN_C, OUT_C, K, AXIS_W>("top runtime 10x12x2",
+                                        cnn_conv_layer_valid, ACT_RELU, 0, 2,
+                                        false, 2);
+    pass &= run_case<5, 7, 3, 5, 3, 16>("9x9x3->5 k3 bus16 runtime 5x7",
+                                        conv_axis<9, 9, 3, 5, 3, 16>,
+                                        ACT_NONE, 0, 3, true);
+    pass &= run_case<12, 100, 3, 4, 3, 32>("12x224x3->4 k3 runtime 12x100",
+                                           conv_axis<12, 224, 3, 4, 3, 32>,
+                                           ACT_NONE, 0, 1, false, 1);
+    pass &= run_pool_case<9, 12, 2, 3, 3, 3, 2, 32>(
+        "13x15x2->3 k3 maxpool3 s2 runtime 9x12",
+        conv_pool_axis<13, 15, 2, 3, 3, 3, 2, 32>, POOL_MAX, ACT_NONE, 0, 2);
+    pass &= run_pool_case<IN_H - 3, IN_W - 2, IN_C, OUT_C, K, POOL_K, POOL_S, AXIS_W>(
+        "top conv+avgpool runtime", cnn_conv_pool_layer, POOL_AVG);
+
+    //连续调用之间更换权重, 检查乒乓缓冲切换
+    pass &= run_case<IN_H, IN_W, IN_C, OUT_C, K, AXIS_W>("top reload 1",
+                                        cnn_conv_layer_valid, ACT_NONE, 0, 1,
+                                        false, IN_C, 1);
+    pass &= run_case<IN_H, IN_W, IN_C, OUT_C, K, AXIS_W>("top reload 2",
+                                        cnn_conv_layer_valid, ACT_NONE, 0, 2,
+                                        false, IN_C, 3);
+    {
+        typedef conv_shape<7, 8, 2, 3, 3> c1;
+        typedef conv_shape<5, 6, 3, 5, 1> c2;
+        typedef conv_shape<5, 6, 5, 2, 3> c3;
+        pass &= run_chain_case<c1, c2, c3, 64>("net runtime 7x8x2",
+                                               conv_chain3<conv_shape<10, 11, 2, 3, 3>,
+                                                           conv_shape<8, 9, 3, 5, 1>,
+                                                           conv_shape<8, 9, 5, 2, 3>,
+                                                           64>);
+    }
 
-END:
+    //Winograd F(2x2,3x3), 与直接法的 golden 逐位比较 (误差上界为 0)
+    pass &= run_case<IN_H, IN_W, IN_C, OUT_C, 3, AXIS_W>("winograd top shape",
+                                        winograd_axis<IN_H, IN_W, IN_C, OUT_C, AXIS_W>,
+                                        ACT_RELU);
+    pass &= run_case<8, 8, 1, 1, 3, 8>("winograd 8x8x1->1 bus8",
+                                       winograd_axis<8, 8, 1, 1, 8>);
+    pass &= run_case<12, 10, 4, 8, 3, 64>("winograd 12x10x4->8 bus64 leaky",
+                                          winograd_axis<12, 10, 4, 8, 64>,
+                                          ACT_LEAKY, 26);
+    pass &= run_case<10, 16, 5, 3, 3, 16>("winograd 10x16x5->3 bus16 3 frames",
+                                          winograd_axis<10, 16, 5, 3, 16>,
+                                          ACT_NONE, 0, 3);
+    pass &= run_case<6, 8, 4, 8, 3, 64>("winograd runtime 6x8x3 tlast",
+                                        winograd_axis<12, 10, 4, 8, 64>,
+                                        ACT_RELU6, 40, 2, true, 3);
+    pass &= run_case<4, 4, 3, 2, 3, 32>("winograd 4x4x3->2 single tile",
+                                        winograd_axis<4, 4, 3, 2, 32>,
+                                        ACT_NONE, 0, 2);
+
+    //深度可分离卷积, 逐点级全并行与分组两种
+    pass &= run_dwsep_case<IN_H, IN_W, IN_C, OUT_C, K, AXIS_W>("top dwsep",
+                                                               cnn_dwsep_layer);
+    pass &= run_dwsep_case<9, 11, 8, 16, 3, 64>("dwsep 9x11x8->16 k3 par4 bus64",
+                                                dwsep_axis<9, 11, 8, 16, 3, 4, 64>, 3);
+    pass &= run_dwsep_case<10, 10, 4, 6, 5, 16>("dwsep 10x10x4->6 k5 par1 bus16",
+                                                dwsep_axis<10, 10, 4, 6, 5, 1, 16>, 2);
+    pass &= run_dwsep_case<9, 11, 8, 16, 3, 64>("dwsep 9x11x8->16 k3 edge bias",
+                                                dwsep_axis<9, 11, 8, 16, 3, 4, 64>,
+                                                2, true);
+
+    //列分块: 行缓冲宽度只需覆盖一个竖条
+    pass &= run_tiled_case<IN_H, 60, IN_W, IN_C, OUT_C, K, AXIS_W>(
+        "top tiled 14x60", cnn_conv_layer_valid, ACT_RELU);
+    pass &= run_tiled_case<12, 101, 16, 3, 4, 3, 32>(
+        "tiled 12x101 strips of 16", conv_axis<12, 16, 3, 4, 3, 32>);
+    pass &= run_tiled_case<12, 37, 10, 4, 8, 5, 64>(
+        "tiled 12x37 k5 strips of 10", conv_axis<12, 10, 4, 8, 5, 64>, ACT_LEAKY, 26);
+    pass &= run_tiled_case<10, 41, 8, 4, 8, 3, 64>(
+        "winograd tiled 10x41 strips of 8", winograd_axis<12, 10, 4, 8, 64>);
+
+    //补零 / 步长 / 膨胀, Winograd 与常数权重顶层只支持 valid, 步长 1
+#if !CONV_WINOGRAD && !CONV_CONST_WEIGHTS
+    pass &= run_ext_case<IN_H, IN_W, IN_C, OUT_C, K, CONV_DIL, 1, CONV_PAD_MAX, AXIS_W>(
+        "top same pad", cnn_conv_layer_top, ACT_RELU, 0, 2);
+    pass &= run_ext_case<IN_H, IN_W, IN_C, OUT_C, K, CONV_DIL, 2, CONV_PAD_MAX, AXIS_W>(
+        "top same pad stride2", cnn_conv_layer_top);
+    pass &= run_ext_case<IN_H, IN_W, IN_C, OUT_C, K, CONV_DIL, 2, 0, AXIS_W>(
+        "top valid stride2", cnn_conv_layer_top, ACT_NONE, 0, 3);
+#endif
+    pass &= run_ext_case<11, 13, 3, 5, 3, 2, 1, 2, 16>(
+        "11x13 k3 dil2 same pad", conv_ext_axis<11, 13, 3, 5, 3, 2, 2, 16>,
+        ACT_LEAKY, 26, 2);
+    pass &= run_ext_case<11, 13, 3, 5, 3, 2, 2, 1, 16>(
+        "11x13 k3 dil2 pad1 stride2", conv_ext_axis<11, 13, 3, 5, 3, 2, 2, 16>);
+    pass &= run_ext_case<12, 9, 4, 8, 5, 1, 2, 2, 64>(
+        "12x9 k5 same pad stride2", conv_ext_axis<12, 9, 4, 8, 5, 1, 2, 64>,
+        ACT_NONE, 0, 2);
+    pass &= run_ext_case<7, 8, 2, 3, 3, 1, 2, 0, 8>(
+        "7x8 k3 valid stride2 bus8", conv_ext_axis<7, 8, 2, 3, 3, 1, 1, 8>);
+    //寄存器非法值: stride 0 / 3 按 1, pad 超过 PMAX 按 PMAX
+    pass &= run_ext_case<11, 13, 3, 5, 3, 2, 1, 2, 16>(
+        "11x13 k3 dil2 stride0 pad9 reg", conv_ext_axis<11, 13, 3, 5, 3, 2, 2, 16>,
+        ACT_NONE, 0, 1, 0, 9);
+    pass &= run_ext_case<7, 8, 2, 3, 3, 1, 1, 1, 8>(
+        "7x8 k3 stride3 pad5 reg", conv_ext_axis<7, 8, 2, 3, 3, 1, 1, 8>,
+        ACT_RELU, 0, 2, 3, 5);
+
+    //性能计数器, 整像素与多像素每拍两种打包
+    pass &= run_perf_case<9, 9, 3, 5, 3, 32>("perf 9x9x3->5 k3 bus32", 3,
+                                              ACT_RELU);
+    pass &= run_perf_case<8, 10, 2, 3, 3, 64>("perf 8x10x2->3 k3 bus64", 2);
+    pass &= run_perf_case<7, 7, 4, 6, 3, 16>("perf 7x7x4->6 k3 bus16", 2);
+
+    //主机参考卷积, 最后一组为基准测试
+    pass &= run_host_case<IN_H, IN_W, IN_C, OUT_C, K>("host top shape", ACT_RELU);
+    pass &= run_host_case<9, 11, 5, 7, 5>("host 9x11x5->7 k5", ACT_LEAKY, 26, 2);
+    pass &= run_host_case<12, 10, 24, 6, 3>("host 12x10x24->6 k3 (vnni tail)");
+    pass &= run_host_case<28, 28, 32, 32, 3>("host bench 28x28x32->32 k3",
+                                             ACT_RELU6, 90);
+
+    //多线程参考模型: 大批量逐块比较, 线程数不影响结果
+    {
+        ref_runner runner(4);
+        pass &= run_batch_verify_case<IN_H, IN_W, IN_C, OUT_C, K, AXIS_W>(
+            "batch top 24 frames", cnn_conv_layer_valid, runner, 24, 3,
+            ACT_RELU);
+        pass &= run_batch_verify_case<20, 18, 8, 16, 3, 64>(
+            "batch 20x18x8->16 k3 bus64 16 frames",
+            conv_axis<20, 18, 8, 16, 3, 64>, runner, 16, 4, ACT_LEAKY, 26);
+        pass &= run_batch_verify_case<9, 9, 3, 5, 3, 16>(
+            "batch 9x9x3->5 k3 bus16 32 frames", conv_axis<9, 9, 3, 5, 3, 16>,
+            runner, 32, 7);
+    }
+    pass &= run_runner_bench<28, 28, 32, 32, 3>("runner bench 28x28x32->32",
+                                                128, 4, 0);
+
+    //常数权重滤波器组
+    pass &= run_const_case<IN_H, IN_W, conv_bank, AXIS_W>(
+        "const bank top shape", ACT_RELU, 0, 2);
+    pass &= run_const_case<9, 12, edge_bank<1>, 8>("const bank 9x12x1 bus8");
+    pass &= run_const_case<10, 8, edge_bank<5>, 64>(
+        "const bank 10x8x5 bus64 chans 3", ACT_LEAKY, 26, 3, 3);
+
+    //位宽组合: int8 x int4, int16 激活, int16 输出, 累加器上界
+    pass &= run_prec_case<IN_H, IN_W, IN_C, OUT_C, K, prec_i8, AXIS_W>(
+        "prec int8 (same as top)", ACT_RELU, 0, 2);
+    pass &= run_prec_case<9, 10, 3, 4, 3, prec<8, 4, 8, 32>, 32>(
+        "prec a8 w4 o8", ACT_LEAKY, 26, 2);
+    pass &= run_prec_case<8, 9, 4, 3, 3, prec<16, 8, 16, 32>, 64>(
+        "prec a16 w8 o16 bus64", ACT_NONE, 0, 2);
+    pass &= run_prec_case<7, 7, 3, 2, 3, prec<16, 16, 16, 32>, 16>(
+        "prec a16 w16 o16 bus16");
+    pass &= run_prec_case<8, 8, 5, 4, 3, prec<8, 4, 16, 16>, 32>(
+        "prec a8 w4 o16 b16", ACT_RELU6, 200);
+    pass &= run_prec_case<6, 6, 3, 2, 3, prec<8, 8, 8, 32>, 32>(
+        "prec int8 extreme", ACT_NONE, 0, 1, true);
+    pass &= run_prec_case<6, 6, 4, 2, 3, prec<16, 4, 16, 8>, 32>(
+        "prec a16 w4 extreme", ACT_NONE, 0, 1, true);
+    //a8 w4 b8 的输出级乘积为 33 位, qshift 取 32~34 与 61~63
+    pass &= run_prec_case<6, 6, 3, 4, 3, prec<8, 4, 8, 8>, 32>(
+        "prec a8 w4 b8 qshift >= P_W", ACT_NONE, 0, 1, false, 12);
+    pass &= run_prec_case<6, 6, 3, 4, 3, prec<8, 4, 8, 8>, 32>(
+        "prec a8 w4 b8 qshift 63", ACT_LEAKY, 26, 1, true, 41);
+
+    //随机回归: 多种上限尺寸与总线宽度, 随机数据与边界值.
+    //常数权重顶层不读随机权重; Winograd 顶层只取偶数尺寸
+#if !CONV_CONST_WEIGHTS
+    pass &= run_random_case<IN_H, IN_W, IN_C, OUT_C, K, AXIS_W>(
+        "random top", cnn_conv_layer_valid, seed, iters, false, CONV_WINOGRAD);
+    pass &= run_random_case<IN_H, IN_W, IN_C, OUT_C, K, AXIS_W>(
+        "random top edge", cnn_conv_layer_valid, seed + 1, iters, true,
+        CONV_WINOGRAD);
+#endif
+    pass &= run_random_case<12, 16, 4, 8, 3, 8>(
+        "random 12x16x4->8 k3 bus8", conv_axis<12, 16, 4, 8, 3, 8>,
+        seed + 2, iters, false);
+    pass &= run_random_case<11, 9, 6, 5, 5, 16>(
+        "random 11x9x6->5 k5 bus16 edge", conv_axis<11, 9, 6, 5, 5, 16>,
+        seed + 3, iters, true);
+    pass &= run_random_case<10, 12, 8, 16, 1, 64>(
+        "random 10x12x8->16 k1 bus64", conv_axis<10, 12, 8, 16, 1, 64>,
+        seed + 4, iters, false);
+    pass &= run_random_case<9, 13, 3, 7, 3, 128>(
+        "random 9x13x3->7 k3 bus128 edge", conv_axis<9, 13, 3, 7, 3, 128>,
+        seed + 5, iters, true);
+
+    //尺寸寄存器非法值: 超过上限按上限, 小于窗口按窗口, Winograd 再取偶数
+#if CONV_WINOGRAD
+    pass &= run_dims_case<IN_H, IN_W, IN_C, OUT_C, K, AXIS_W>(
+        "dims top rows 0 cols 999 reg", cnn_conv_layer_valid, 0, 999, 4, IN_W);
+#elif !CONV_CONST_WEIGHTS
+    pass &= run_dims_case<IN_H, IN_W, IN_C, OUT_C, K, AXIS_W>(
+        "dims top rows 0 cols 999 reg", cnn_conv_layer_valid, 0, 999,
+        (K - 1) * CONV_DIL + 1, IN_W);
+#endif
+    pass &= run_dims_case<12, 16, 4, 8, 3, 32>(
+        "dims 12x16 rows 65535 cols 1 reg", conv_axis<12, 16, 4, 8, 3, 32>,
+        65535, 1, 12, 3);
+    pass &= run_dims_case<12, 10, 4, 8, 3, 64>(
+        "dims winograd 12x10 rows 9 cols 40 reg", winograd_axis<12, 10, 4, 8, 64>,
+        9, 40, 8, 10);
+
+    //异步运行时: 预处理与 C 仿真流水, 连续请求合批 (顶层须从端口读权重)
+#if !CONV_CONST_WEIGHTS
+    pass &= run_runtime_case<IN_H, IN_W, IN_C, OUT_C, K, AXIS_W>(
+        "runtime top", cnn_conv_layer_valid, 64, 4, 4, ACT_RELU);
+#endif
+    pass &= run_runtime_case<28, 28, 8, 8, 3, 64>(
+        "runtime 28x28x8->8 k3 bus64", conv_axis<28, 28, 8, 8, 3, 64>, 32, 3, 2);
+
+    //脉动阵列 GEMM: 部分行块 / 列块, 全连接分类头, 两种权重打包; 最后为基准
+    pass &= run_gemm_case<GEMM_PR, GEMM_PC, GEMM_K, GEMM_N, AXIS_W>(
+        "gemm top 10x200x60", cnn_gemm_layer, 10, 200, 60, ACT_RELU);
+    pass &= run_gemm_case<GEMM_PR, GEMM_PC, GEMM_K, GEMM_N, AXIS_W>(
+        "gemm top fc 1x256x10", cnn_gemm_layer, 1, GEMM_K, 10);
+    pass &= run_gemm_case<2, 4, 32, 16, 64>(
+        "gemm 2x4 7x19x13 bus64", gemm_axis<2, 4, 32, 16, 64>, 7, 19, 13,
+        ACT_LEAKY, 26);
+    pass &= run_gemm_case<3, 16, 40, 40, 16>(
+        "gemm 3x16 5x33x35 bus16", gemm_axis<3, 16, 40, 40, 16>, 5, 33, 35,
+        ACT_RELU6, 90);
+    pass &= run_gemm_case<2, 4, 32, 16, 64>(
+        "gemm 2x4 6x29x11 edge bias", gemm_axis<2, 4, 32, 16, 64>, 6, 29, 11,
+        ACT_NONE, 0, true);
+    pass &= run_gemm_case<GEMM_PR, GEMM_PC, GEMM_K, GEMM_N, AXIS_W>(
+        "gemm top bench 256x256x64", cnn_gemm_layer, 256, GEMM_K, GEMM_N);
+
+    //文件回放: .npy 与原始输入, 分块送入, 部分通道 (顶层须从端口读权重)
+#if !CONV_CONST_WEIGHTS
+    pass &= run_file_case<IN_H, IN_W, IN_C, OUT_C, K, AXIS_W>(
+        "file top npy", cnn_conv_layer_valid, 20, IN_H, IN_W, IN_C, 8, false,
+        ACT_RELU);
+    pass &= run_file_case<IN_H, IN_W, IN_C, OUT_C, K, AXIS_W>(
+        "file top raw", cnn_conv_layer_valid, 5, IN_H, IN_W, IN_C, 2, true);
+#endif
+    pass &= run_file_case<12, 16, 4, 8, 3, 32>(
+        "file 10x13x3 in 12x16x4->8 k3 bus32", conv_axis<12, 16, 4, 8, 3, 32>,
+        7, 10, 13, 3, 3, false, ACT_LEAKY, 26);
+
+    std::cout << "total " << wall_ms() - t_start << " ms" << std::endl;
     if (pass)
         std::cout << "TEST PASSED" << std::endl;
     else
         std::cout << "TEST FAILED" << std::endl;
 
-    return 0;
+    return pass ? 0 : 1;
 }
-
@@ -0,0 +1,296 @@
+/*******************************************************************************
+MIT License
+
+Copyright (c) 2021 LEON-LINKS-room
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#ifndef __TENSOR_IO_H__
+#define __TENSOR_IO_H__
+
+/*
+ * 测试数据文件: .npy (NumPy 1.0/2.0 格式, C 顺序) 或无文件头的原始数据
+ * 文件通过 mmap 映射, data() 直接指向文件内容, 大文件按需换页, 不整体
+ * 读入内存. create_npy 预先确定大小并写好文件头, 结果直接写入映射区.
+ * 支持整数类型 |i1 / <i1 / <i2 / <i4 (小端).
+ * 无 mmap 的平台 (Windows) 退回为整体读入, close 时写回.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#define TENSOR_IO_MMAP 0
+#else
+#define TENSOR_IO_MMAP 1
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+class tensor_file {
+public:
+    tensor_file() : base_(0), size_(0), offset_(0), elem_(0),
+                    writable_(false), fd_(-1) {}
+    ~tensor_file() { close(); }
+
+    //只读打开 .npy, 从文件头得到类型与形状
+    bool open_npy(const char *path) {
+        if (!map(path, false, 0))
+            return false;
+        return parse_header();
+    }
+
+    //只读打开原始数据文件, 形状与元素字节数由调用者给出
+    bool open_raw(const char *path, const std::vector<long> &shape, int elem) {
+        if (!map(path, false, 0))
+            return false;
+        shape_ = shape;
+        elem_ = elem;
+        offset_ = 0;
+        if ((long long)count() * elem_ != (long long)size_)
+            return fail("raw file size does not match shape");
+        return true;
+    }
+
+    //新建 .npy 并映射为可写, descr 如 "|i1"
+    bool create_npy(const char *path, const char *descr,
+                    const std::vector<long> &shape) {
+        shape_ = shape;
+        elem_ = descr_size(descr);
+        if (elem_ == 0)
+            return fail("unsupported dtype");
+
+        //文件头按 64 字节对齐, 以换行结束
+        std::string dict = std::string("{'descr': '") + descr +
+                           "', 'fortran_order': False, 'shape': (";
+        for (size_t i = 0; i < shape.size(); i++) {
+            char num[32];
+            sprintf(num, "%ld", shape[i]);
+            dict += num;
+            dict += (shape.size() == 1 || i + 1 < shape.size()) ? ", " : "";
+        }
+        dict += "), }";
+        size_t hlen = dict.size() + 1;
+        size_t total = 10 + hlen;
+        total = (total + 63) / 64 * 64;
+        dict.append(total - 10 - hlen, ' ');
+        dict += '\n';
+
+        offset_ = total;
+        if (!map(path, true, offset_ + (size_t)count() * elem_))
+            return false;
+
+        unsigned char *p = (unsigned char *)base_;
+        memcpy(p, "\x93NUMPY\x01\x00", 8);
+        p[8] = (unsigned char)((total - 10) & 0xff);
+        p[9] = (unsigned char)((total - 10) >> 8);
+        memcpy(p + 10, dict.data(), dict.size());
+        return true;
+    }
+
+    void close() {
+        if (!base_)
+            return;
+#if TENSOR_IO_MMAP
+        if (writable_)
+            msync(base_, size_, MS_SYNC);
+        munmap(base_, size_);
+        ::close(fd_);
+#else
+        if (writable_) {
+            FILE *f = fopen(path_.c_str(), "wb");
+            if (f) {
+                fwrite(base_, 1, size_, f);
+                fclose(f);
+            }
+        }
+        delete[] (char *)base_;
+#endif
+        base_ = 0;
+        size_ = 0;
+        fd_ = -1;
+    }
+
+    const std::vector<long> &shape() const { return shape_; }
+    int elem_size() const { return elem_; }
+    const char *error() const { return err_.c_str(); }
+
+    long count() const {
+        long n = 1;
+        for (size_t i = 0; i < shape_.size(); i++)
+            n *= shape_[i];
+        return n;
+    }
+
+    template<class T>
+    T *data() { return (T *)((char *)base_ + offset_); }
+
+private:
+    static int descr_size(const std::string &d) {
+        if (d == "|i1" || d == "<i1" || d == "i1")
+            return 1;
+        if (d == "<i2")
+            return 2;
+        if (d == "<i4")
+            return 4;
+        return 0;
+    }
+
+    bool fail(const char *msg) {
+        err_ = msg;
+        close();
+        return false;
+    }
+
+    bool map(const char *path, bool create, size_t size) {
+        close();
+        writable_ = create;
+        path_ = path;
+#if TENSOR_IO_MMAP
+        fd_ = create ? ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644)
+                     : ::open(path, O_RDONLY);
+        if (fd_ < 0)
+            return fail("cannot open file");
+        if (create) {
+            if (ftruncate(fd_, size) != 0) {
+                ::close(fd_);
+                return fail("cannot resize file");
+            }
+        }
+        else {
+            struct stat st;
+            fstat(fd_, &st);
+            size = st.st_size;
+        }
+        if (size == 0) {
+            ::close(fd_);
+            return fail("empty file");
+        }
+        void *p = mmap(0, size, create ? PROT_READ | PROT_WRITE : PROT_READ,
+                       MAP_SHARED, fd_, 0);
+        if (p == MAP_FAILED) {
+            ::close(fd_);
+            return fail("mmap failed");
+        }
+        //按顺序读取, 提示内核预读并及时回收
+        madvise(p, size, MADV_SEQUENTIAL);
+        base_ = p;
+#else
+        char *p;
+        if (create) {
+            p = new char[size]();
+        }
+        else {
+            FILE *f = fopen(path, "rb");
+            if (!f)
+                return fail("cannot open file");
+            fseek(f, 0, SEEK_END);
+            size = ftell(f);
+            fseek(f, 0, SEEK_SET);
+            p = new char[size];
+            if (fread(p, 1, size, f) != size) {
+                fclose(f);
+                delete[] p;
+                return fail("cannot read file");
+            }
+            fclose(f);
+        }
+        base_ = p;
+#endif
+        size_ = size;
+        return true;
+    }
+
+    //解析 .npy 文件头中的 descr / fortran_order / shape
+    bool parse_header() {
+        const unsigned char *p = (const unsigned char *)base_;
+        if (size_ < 10 || memcmp(p, "\x93NUMPY", 6) != 0)
+            return fail("not a .npy file");
+
+        size_t hlen;
+        size_t hstart;
+        if (p[6] == 1) {
+            hlen = p[8] | (p[9] << 8);
+            hstart = 10;
+        }
+        else {
+            if (size_ < 12)
+                return fail("truncated .npy header");
+            hlen = p[8] | (p[9] << 8) | (p[10] << 16) | ((size_t)p[11] << 24);
+            hstart = 12;
+        }
+        if (hstart + hlen > size_)
+            return fail("truncated .npy header");
+        std::string h((const char *)p + hstart, hlen);
+        offset_ = hstart + hlen;
+
+        size_t d = h.find("'descr'");
+        size_t q1 = h.find('\'', h.find(':', d));
+        size_t q2 = h.find('\'', q1 + 1);
+        if (d == std::string::npos || q1 == std::string::npos ||
+            q2 == std::string::npos)
+            return fail("no descr in .npy header");
+        elem_ = descr_size(h.substr(q1 + 1, q2 - q1 - 1));
+        if (elem_ == 0)
+            return fail("unsupported dtype");
+
+        if (h.find("'fortran_order': True") != std::string::npos)
+            return fail("fortran order not supported");
+
+        size_t s = h.find('(', h.find("'shape'"));
+        size_t e = h.find(')', s);
+        if (s == std::string::npos || e == std::string::npos)
+            return fail("no shape in .npy header");
+        shape_.clear();
+        const char *c = h.c_str() + s + 1;
+        while (c < h.c_str() + e) {
+            char *next;
+            long v = strtol(c, &next, 10);
+            if (next == c) {
+                c++;
+                continue;
+            }
+            shape_.push_back(v);
+            c = next;
+        }
+
+        if ((unsigned long long)offset_ + (unsigned long long)count() * elem_ >
+            size_)
+            return fail(".npy data shorter than shape");
+        return true;
+    }
+
+    void *base_;
+    size_t size_;
+    size_t offset_;
+    int elem_;
+    bool writable_;
+    int fd_;
+    std::vector<long> shape_;
+    std::string path_;
+    std::string err_;
+};
+
+#endif